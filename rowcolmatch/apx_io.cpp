@@ -0,0 +1,264 @@
+#include "csv_io.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "mapped_file.h"
+
+// Native reader for the .apx binary format defined by FileHeader and
+// AbstractAstroPixReadout in astropix_analysis/fileio.py / fmt.py. The
+// container layout is:
+//
+//   '%APXDF'                                  6-byte magic
+//   uint32 LE header length, JSON header      carries 'readout_uid'
+//   repeated readout records:
+//     fe dc ba                                record header
+//     uint32 LE readout_id
+//     uint64 LE timestamp (ns since epoch)
+//     uint32 LE length, then <length> raw chip bytes
+//
+// The raw chip stream is idle (0xbc) / padding (0xff) bytes around
+// 8-byte AstroPix4 hit words whose start byte (pre bit-reversal) is
+// 111xxxxx; hits can straddle record boundaries, in which case the
+// trailing bytes of one record are re-assembled with the orphan bytes
+// at the head of the next.
+
+namespace {
+
+constexpr unsigned char kIdleByte = 0xbc;
+constexpr unsigned char kPaddingByte = 0xff;
+constexpr std::size_t kHitSize = 8;
+constexpr int kAstroPix4Uid = 4000;
+constexpr double kClockCyclesPerUs = 20.;
+constexpr long kClockRollover = 1L << 17;
+
+bool isValidStartByte(unsigned char byte) {
+    return byte != kPaddingByte && (byte >> 5) == 7;
+}
+
+// Bit order within each byte is reversed in the stream coming from the
+// DAQ board; build the reversal table once.
+struct BitReverseTable {
+    unsigned char tab[256];
+    BitReverseTable() {
+        for (int i = 0; i < 256; ++i) {
+            unsigned char r = 0;
+            for (int b = 0; b < 8; ++b) {
+                r = (r << 1) | ((i >> b) & 1);
+            }
+            tab[i] = r;
+        }
+    }
+};
+
+long grayToDecimal(long gray) {
+    long decimal = gray;
+    long mask = gray;
+    while (mask) {
+        mask >>= 1;
+        decimal ^= mask;
+    }
+    return decimal;
+}
+
+uint32_t readU32(const char*& p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return v;
+}
+
+uint64_t readU64(const char*& p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return v;
+}
+
+// Decodes one 8-byte AstroPix4 hit word into a row/col HalfHit pair.
+// AstroPix4 reads both coordinates out in a single hit, so the pair is
+// exact: match with --mints 0 --maxts 0 --mintot 0 --maxtot 0.
+void decodeHit(const unsigned char* raw, long long fpgaTs,
+               const BitReverseTable& reverse, std::vector<HalfHit>& out) {
+    // Reverse the bit order within each byte, then treat the word as a
+    // 64-bit MSB-first bit pattern, exactly like fmt.py's BitPattern.
+    uint64_t word = 0;
+    for (std::size_t i = 0; i < kHitSize; ++i) {
+        word = (word << 8) | reverse.tab[raw[i]];
+    }
+    auto bits = [word](int start, int stop) -> long {
+        return (word >> (64 - stop)) & ((1L << (stop - start)) - 1);
+    };
+
+    int chipId = static_cast<int>(bits(0, 5));
+    int row = static_cast<int>(bits(8, 13));
+    int column = static_cast<int>(bits(13, 18));
+    long tsDec1 = grayToDecimal((bits(19, 33) << 3) + bits(33, 36));
+    long tsDec2 = grayToDecimal((bits(42, 56) << 3) + bits(56, 59));
+    if (tsDec2 < tsDec1) {
+        tsDec2 += kClockRollover;
+    }
+    int tot = static_cast<int>(tsDec2 - tsDec1);
+    double totUs = tot / kClockCyclesPerUs;
+
+    HalfHit h;
+    h.layer = 0;
+    h.chipID = chipId;
+    // Structurally valid by construction; use the marker value the
+    // corruption filter in main.cpp expects.
+    h.payload = 4;
+    h.timestamp = static_cast<int>(tsDec1 & 0xff);
+    h.tot_total = tot;
+    h.tot_us = totUs;
+    h.fpga_ts = fpgaTs;
+
+    h.location = row;
+    h.isCol = 0;
+    out.push_back(h);
+    h.location = column;
+    h.isCol = 1;
+    out.push_back(h);
+}
+
+// Scans one readout record's raw chip stream for hit words. carry holds
+// the truncated tail of the previous record (if its first byte was a
+// valid start byte) and is updated for the next record.
+void decodeReadout(const unsigned char* data, std::size_t size,
+                   long long fpgaTs, const BitReverseTable& reverse,
+                   std::string& carry, std::vector<HalfHit>& out) {
+    std::size_t cursor = 0;
+
+    // Skip leading idle/padding and try to stitch orphan bytes onto the
+    // previous record's tail.
+    while (cursor < size &&
+           (data[cursor] == kIdleByte || data[cursor] == kPaddingByte)) {
+        ++cursor;
+    }
+    if (cursor < size && !isValidStartByte(data[cursor])) {
+        std::size_t orphanStart = cursor;
+        while (cursor < size && !isValidStartByte(data[cursor])) {
+            ++cursor;
+        }
+        std::size_t orphanEnd = cursor;
+        while (orphanEnd > orphanStart &&
+               data[orphanEnd - 1] == kIdleByte) {
+            --orphanEnd;
+        }
+        if (!carry.empty() &&
+            carry.size() + (orphanEnd - orphanStart) == kHitSize) {
+            std::string word = carry;
+            word.append(reinterpret_cast<const char*>(data) + orphanStart,
+                        orphanEnd - orphanStart);
+            decodeHit(reinterpret_cast<const unsigned char*>(word.data()),
+                      fpgaTs, reverse, out);
+        }
+    }
+    carry.clear();
+
+    while (cursor < size) {
+        while (cursor < size &&
+               (data[cursor] == kIdleByte || data[cursor] == kPaddingByte)) {
+            ++cursor;
+        }
+        if (cursor == size) {
+            break;
+        }
+        if (!isValidStartByte(data[cursor])) {
+            // Garbage between hits: drop bytes until the next start byte.
+            ++cursor;
+            continue;
+        }
+        if (cursor + kHitSize > size) {
+            // Truncated hit at the end of the record; set it aside for
+            // re-assembly with the next record's orphan bytes.
+            carry.assign(reinterpret_cast<const char*>(data) + cursor,
+                         size - cursor);
+            break;
+        }
+        decodeHit(data + cursor, fpgaTs, reverse, out);
+        cursor += kHitSize;
+    }
+}
+
+} // namespace
+
+bool ApxReader::decodeDatagram(const unsigned char* data, std::size_t size,
+                               std::string& carry,
+                               std::vector<HalfHit>& out) {
+    static const unsigned char recordHeader[] = {0xfe, 0xdc, 0xba};
+    static const BitReverseTable reverse;
+    if (size < 3 + 4 + 8 + 4 || std::memcmp(data, recordHeader, 3) != 0) {
+        return false;
+    }
+    const char* p = reinterpret_cast<const char*>(data) + 3;
+    readU32(p);                     // readout_id
+    uint64_t timestamp = readU64(p);
+    uint32_t length = readU32(p);
+    if (reinterpret_cast<const unsigned char*>(p) + length != data + size) {
+        return false;
+    }
+    decodeReadout(reinterpret_cast<const unsigned char*>(p), length,
+                  static_cast<long long>(timestamp), reverse, carry, out);
+    return true;
+}
+
+bool ApxReader::isApxFile(const std::string& filename) {
+    std::string ext(EXTENSION);
+    return filename.size() >= ext.size() &&
+           filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+std::vector<HalfHit> ApxReader::readHalfHits(const std::string& filename) {
+    MappedFile map(filename);
+    const char* p = map.data;
+    const char* end = map.data + map.size;
+
+    static const char magic[] = "%APXDF";
+    constexpr std::size_t magicSize = 6;
+    if (map.size < magicSize + 4 || std::memcmp(p, magic, magicSize) != 0) {
+        throw std::runtime_error("Invalid magic number in " + filename);
+    }
+    p += magicSize;
+
+    uint32_t headerLength = readU32(p);
+    if (p + headerLength > end) {
+        throw std::runtime_error("Truncated file header in " + filename);
+    }
+    std::string header(p, headerLength);
+    p += headerLength;
+
+    // Minimal JSON probe: all we need from the header is the readout
+    // class uid, to make sure we know how to decode the records.
+    std::size_t key = header.find("\"readout_uid\"");
+    if (key == std::string::npos) {
+        throw std::runtime_error("No readout_uid in file header of " + filename);
+    }
+    int uid = std::atoi(header.c_str() + header.find(':', key) + 1);
+    if (uid != kAstroPix4Uid) {
+        throw std::runtime_error("Unsupported readout uid " +
+                                 std::to_string(uid) + " in " + filename);
+    }
+
+    static const unsigned char recordHeader[] = {0xfe, 0xdc, 0xba};
+    const BitReverseTable reverse;
+    std::vector<HalfHit> data;
+    data.reserve(map.size / 8);
+    std::string carry;
+
+    while (p < end) {
+        if (end - p < 3 + 4 + 8 + 4 ||
+            std::memcmp(p, recordHeader, 3) != 0) {
+            throw std::runtime_error("Invalid readout header in " + filename);
+        }
+        p += 3;
+        readU32(p);                     // readout_id
+        uint64_t timestamp = readU64(p);
+        uint32_t length = readU32(p);
+        if (p + length > end) {
+            throw std::runtime_error("Truncated readout in " + filename);
+        }
+        decodeReadout(reinterpret_cast<const unsigned char*>(p), length,
+                      static_cast<long long>(timestamp), reverse, carry, data);
+        p += length;
+    }
+    return data;
+}
@@ -0,0 +1,242 @@
+#include "batch.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#include "binary_io.h"
+#include "csv_io.h"
+#include "filter.h"
+#include "partition.h"
+
+namespace {
+
+// Shared task pool for the batch workers. Workers pull the next
+// pending task off the front; running tasks may push further tasks
+// (the per-bucket fan-out of a large file), which idle workers steal
+// immediately. work() returns once every task, including spawned ones,
+// has completed.
+class TaskPool {
+public:
+    void push(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+            ++outstanding_;
+        }
+        cv_.notify_one();
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [&]() {
+                return !tasks_.empty() || outstanding_ == 0;
+            });
+            if (tasks_.empty()) {
+                return;
+            }
+            auto task = std::move(tasks_.front());
+            tasks_.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+            if (--outstanding_ == 0) {
+                cv_.notify_all();
+            }
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::size_t outstanding_ = 0;
+};
+
+// Everything a file accumulates between its load task and its last
+// bucket task; shared by the fan-out tasks of a split file.
+struct FileState {
+    std::string filename;
+    std::size_t nRead = 0;
+    std::size_t nValid = 0;
+    ChipPartitions parts;
+    std::vector<std::vector<MatchedHit>> bucketMatches;
+    std::atomic<std::size_t> bucketsLeft{0};
+};
+
+std::size_t fileSizeBytes(const std::string& filename) {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0
+        ? static_cast<std::size_t>(st.st_size) : 0;
+}
+
+using MatchFn = std::vector<MatchedHit> (*)(const HalfHit*, size_t,
+                                            WindowPredicate,
+                                            WindowPredicate);
+
+MatchFn matchFn(const std::string& engine) {
+    if (engine == "window") {
+        return rowcolmatchWindowed;
+    }
+    return rowcolmatch;
+}
+
+// Serializes each completed file's summary block and write, so output
+// from concurrent workers does not interleave.
+std::mutex gIoMutex;
+
+void matchBucket(FileState& state, const BatchOptions& opt, std::size_t b) {
+    int layer = static_cast<int>(b) / opt.chips;
+    int chip = static_cast<int>(b) % opt.chips;
+    state.bucketMatches[b] = matchFn(opt.engine)(
+        state.parts.data(layer, chip),
+        state.parts.size(layer, chip),
+        opt.fts, opt.ftot);
+}
+
+// Layer-major merge, summary and output write, run by whichever worker
+// finishes the file's last bucket.
+void finishFile(FileState& state, const BatchOptions& opt) {
+    std::vector<MatchedHit> allMatches;
+    std::ostringstream summary;
+
+    double pct = state.nRead == 0
+        ? 0.0 : 100.0 * state.nValid / state.nRead;
+    summary << state.filename << ": "
+            << state.nRead << " decoded halfhits read, "
+            << state.nValid << " valid ("
+            << std::fixed << std::setprecision(2) << pct << "%)\n";
+
+    for (int layer = 0; layer < opt.layers; ++layer) {
+        for (int chip = 0; chip < opt.chips; ++chip) {
+            std::size_t nchip = state.parts.size(layer, chip);
+            const auto& matches =
+                state.bucketMatches[layer * opt.chips + chip];
+            double mpct = nchip == 0
+                ? 0.0 : 100.0 * matches.size() * 2.0 / nchip;
+            summary << "  Layer " << layer
+                    << ", Chip " << chip
+                    << ": " << nchip
+                    << " halfhits found, "
+                    << matches.size()
+                    << " hits matched ("
+                    << std::fixed << std::setprecision(2) << mpct << "%)\n";
+            allMatches.insert(allMatches.end(),
+                              matches.begin(), matches.end());
+        }
+    }
+
+    std::string base = matchedOutputBase(state.filename);
+    if (opt.format == "binary") {
+        BinaryColumnWriter::writeMatchedHits(base + "_matched.bin",
+                                             allMatches);
+    } else {
+        CSVWriter::writeMatchedHits(base + "_matched.csv", allMatches);
+    }
+
+    if (!opt.quiet) {
+        std::lock_guard<std::mutex> lock(gIoMutex);
+        std::cout << summary.str();
+    }
+}
+
+// Load task for one file: read, filter and partition, then either
+// match inline (small files) or fan the buckets out as stealable
+// tasks (large ones).
+void processFile(TaskPool& pool, const std::string& filename,
+                 const BatchOptions& opt, std::atomic<int>& failures) {
+    try {
+        auto state = std::make_shared<FileState>();
+        state->filename = filename;
+
+        auto data = ApxReader::isApxFile(filename)
+            ? ApxReader::readHalfHits(filename)
+            : !CSVReader::isRegularFile(filename)
+                ? CSVReader::readHalfHitsPrefetch(filename, 1)
+                : CSVReader::isCompressed(filename)
+                    ? CSVReader::readHalfHitsCompressed(filename)
+                    : CSVReader::readHalfHitsMapped(filename);
+        state->nRead = data.size();
+
+        auto dataf = filterHits(data);
+        state->nValid = dataf.size();
+        data.clear();
+        data.shrink_to_fit();
+
+        state->parts = partitionByChip(dataf, opt.layers, opt.chips);
+        std::size_t nBuckets =
+            static_cast<std::size_t>(opt.layers) * opt.chips;
+        state->bucketMatches.resize(nBuckets);
+
+        if (opt.threads > 1 && nBuckets > 1 &&
+            fileSizeBytes(filename) >= opt.splitBytes) {
+            state->bucketsLeft = nBuckets;
+            for (std::size_t b = 0; b < nBuckets; ++b) {
+                pool.push([state, &opt, &failures, b]() {
+                    try {
+                        matchBucket(*state, opt, b);
+                        if (state->bucketsLeft.fetch_sub(1) == 1) {
+                            finishFile(*state, opt);
+                        }
+                    } catch (const std::exception& e) {
+                        ++failures;
+                        std::lock_guard<std::mutex> lock(gIoMutex);
+                        std::cerr << state->filename << ": "
+                                  << e.what() << "\n";
+                    }
+                });
+            }
+        } else {
+            for (std::size_t b = 0; b < nBuckets; ++b) {
+                matchBucket(*state, opt, b);
+            }
+            finishFile(*state, opt);
+        }
+    } catch (const std::exception& e) {
+        ++failures;
+        std::lock_guard<std::mutex> lock(gIoMutex);
+        std::cerr << filename << ": " << e.what() << "\n";
+    }
+}
+
+} // namespace
+
+int processBatch(const std::vector<std::string>& files,
+                 const BatchOptions& opt) {
+    // Largest-first scheduling: the big files start while the small
+    // ones backfill idle workers, instead of a 100x file landing last.
+    std::vector<std::string> ordered = files;
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [](const std::string& a, const std::string& b) {
+                         return fileSizeBytes(a) > fileSizeBytes(b);
+                     });
+
+    TaskPool pool;
+    std::atomic<int> failures{0};
+    for (const auto& file : ordered) {
+        pool.push([&pool, &opt, &failures, file]() {
+            processFile(pool, file, opt, failures);
+        });
+    }
+
+    unsigned nWorkers = opt.threads > 0 ? opt.threads : 1;
+    std::vector<std::thread> workers;
+    workers.reserve(nWorkers - 1);
+    for (unsigned w = 1; w < nWorkers; ++w) {
+        workers.emplace_back([&pool]() { pool.work(); });
+    }
+    pool.work();
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    return failures.load();
+}
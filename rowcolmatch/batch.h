@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "rowcolmatch.h"
+
+// Multi-file batch driver: processes a whole run campaign in one
+// process instead of a shell loop of cold-started ones, sharing the
+// worker pool and the page cache across files.
+
+struct BatchOptions {
+    int layers = 3;
+    int chips = 4;
+    int threads = 1;
+    WindowPredicate fts{0, 1};
+    WindowPredicate ftot{6, 15};
+    // "scan" or "window", as in the single-file path.
+    std::string engine = "scan";
+    // "csv" or "binary".
+    std::string format = "csv";
+    bool quiet = false;
+    // Files at least this large are split into independent (layer,
+    // chip) match tasks; smaller ones are matched whole by one worker.
+    std::size_t splitBytes = 64 * 1024 * 1024;
+};
+
+// Processes every file on a shared work-stealing pool: each file starts
+// as one task, idle workers pull the next pending task, and a large
+// file's match phase fans out into per-bucket tasks that backfill the
+// pool. Files are scheduled largest-first to keep the tail short, and
+// each _matched output is written as soon as its file completes.
+// Returns the number of files that failed.
+int processBatch(const std::vector<std::string>& files,
+                 const BatchOptions& opt);
@@ -0,0 +1,168 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "data_structs.h"
+#include "csv_io.h"
+#include "filter.h"
+#include "partition.h"
+#include "rowcolmatch.h"
+
+// Benchmark harness for the rowcolmatch pipeline (built by `make bench`).
+//
+// Generates a deterministic synthetic half-hit stream with a realistic
+// row/col burst structure and a configurable corruption fraction, then
+// times the parse, filter, match and write phases separately. Results
+// go to stdout as CSV (phase,hits,seconds,hits_per_s) so throughput can
+// be tracked per commit.
+
+namespace {
+
+struct BenchOptions {
+    std::size_t hits = 1000000;
+    int layers = 3;
+    int chips = 4;
+    int maxBurst = 3;        // max columns following a row
+    double corrupt = 0.05;   // fraction of hits failing the validity cut
+    unsigned seed = 20250723;
+};
+
+// Deterministic half-hit generator: each "event" is a row followed by a
+// short burst of columns on the same chip with timestamps/ToTs inside
+// the default match windows, sprinkled with corrupted hits that the
+// filter stage must reject.
+std::vector<HalfHit> generateHalfHits(const BenchOptions& opt) {
+    std::mt19937 rng(opt.seed);
+    std::uniform_int_distribution<int> layerDist(0, opt.layers - 1);
+    std::uniform_int_distribution<int> chipDist(0, opt.chips - 1);
+    std::uniform_int_distribution<int> locDist(0, 34);
+    std::uniform_int_distribution<int> tsDist(3, 255);
+    std::uniform_int_distribution<int> totDist(30, 400);
+    std::uniform_int_distribution<int> burstDist(0, opt.maxBurst);
+    std::uniform_int_distribution<int> dtsDist(0, 2);
+    std::uniform_int_distribution<int> dtotDist(0, 20);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    std::vector<HalfHit> hits;
+    hits.reserve(opt.hits);
+    long long fpgaTs = 1000;
+
+    while (hits.size() < opt.hits) {
+        int layer = layerDist(rng);
+        int chip = chipDist(rng);
+        int ts = tsDist(rng);
+        int tot = totDist(rng);
+        fpgaTs += 1 + static_cast<long long>(unit(rng) * 50);
+
+        bool corrupted = unit(rng) < opt.corrupt;
+        HalfHit row{layer, chip, corrupted ? 7 : 4, locDist(rng), 0,
+                    ts, tot, tot / 100.0, fpgaTs};
+        hits.push_back(row);
+
+        int burst = burstDist(rng);
+        for (int j = 0; j < burst && hits.size() < opt.hits; ++j) {
+            int ctot = tot - dtotDist(rng);
+            HalfHit col{layer, chip, 4, locDist(rng), 1,
+                        ts - dtsDist(rng), ctot, ctot / 100.0, fpgaTs + 1};
+            hits.push_back(col);
+        }
+    }
+    return hits;
+}
+
+void writeHalfHitCsv(const std::string& path,
+                     const std::vector<HalfHit>& hits) {
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::fputs("idx,readout,layer,chipID,payload,location,isCol,"
+               "timestamp,tot_msb,tot_lsb,tot_total,tot_us,fpga_ts\n", f);
+    for (std::size_t i = 0; i < hits.size(); ++i) {
+        const auto& h = hits[i];
+        std::fprintf(f, "%zu,%zu,%d,%d,%d,%d,%d,%d,%d,%d,%d,%g,%lld\n",
+                     i, i / 2, h.layer, h.chipID, h.payload, h.location,
+                     h.isCol, h.timestamp, h.tot_total >> 8,
+                     h.tot_total & 255, h.tot_total, h.tot_us, h.fpga_ts);
+    }
+    std::fclose(f);
+}
+
+double seconds(std::chrono::steady_clock::time_point t0,
+               std::chrono::steady_clock::time_point t1) {
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+void report(const char* phase, std::size_t hits, double secs) {
+    std::cout << phase << "," << hits << "," << secs << ","
+              << (secs > 0 ? hits / secs : 0.0) << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--hits") opt.hits = std::stoull(argv[++i]);
+        else if (arg == "--layers") opt.layers = std::stoi(argv[++i]);
+        else if (arg == "--chips") opt.chips = std::stoi(argv[++i]);
+        else if (arg == "--burst") opt.maxBurst = std::stoi(argv[++i]);
+        else if (arg == "--corrupt") opt.corrupt = std::stod(argv[++i]);
+        else if (arg == "--seed") opt.seed = std::stoul(argv[++i]);
+        else {
+            std::cerr << "Usage: rowcolmatch_bench [--hits N] [--layers N] "
+                         "[--chips N] [--burst N] [--corrupt F] [--seed N]\n";
+            return 1;
+        }
+    }
+
+    using clock = std::chrono::steady_clock;
+    std::string csvPath = "bench_input.csv";
+
+    auto truth = generateHalfHits(opt);
+    writeHalfHitCsv(csvPath, truth);
+
+    std::cout << "phase,hits,seconds,hits_per_s\n";
+
+    auto t0 = clock::now();
+    auto data = CSVReader::readHalfHitsMapped(csvPath);
+    auto t1 = clock::now();
+    report("parse", data.size(), seconds(t0, t1));
+
+    t0 = clock::now();
+    auto dataf = filterHits(data);
+    t1 = clock::now();
+    report("filter", data.size(), seconds(t0, t1));
+
+    t0 = clock::now();
+    auto parts = partitionByChip(dataf, opt.layers, opt.chips);
+    t1 = clock::now();
+    report("partition", dataf.size(), seconds(t0, t1));
+
+    std::vector<MatchedHit> allMatches;
+    t0 = clock::now();
+    for (int layer = 0; layer < opt.layers; ++layer) {
+        for (int chip = 0; chip < opt.chips; ++chip) {
+            auto matches = rowcolmatch(parts.data(layer, chip),
+                                       parts.size(layer, chip),
+                                       WindowPredicate{0, 1},
+                                       WindowPredicate{6, 15});
+            allMatches.insert(allMatches.end(),
+                              matches.begin(), matches.end());
+        }
+    }
+    t1 = clock::now();
+    report("match", dataf.size(), seconds(t0, t1));
+
+    t0 = clock::now();
+    CSVWriter::writeMatchedHits("bench_matched.csv", allMatches);
+    t1 = clock::now();
+    report("write", allMatches.size(), seconds(t0, t1));
+
+    std::remove(csvPath.c_str());
+    std::remove("bench_matched.csv");
+    return 0;
+}
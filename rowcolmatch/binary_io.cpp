@@ -0,0 +1,94 @@
+#include "binary_io.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// A large user-space buffer keeps the column writes as a handful of
+// big sequential transfers instead of per-value stream operations.
+constexpr std::size_t kWriteBufferSize = 4 * 1024 * 1024;
+
+struct ColumnSpec {
+    const char* name;
+    const char* dtype;
+};
+
+constexpr ColumnSpec kColumns[] = {
+    {"layer", "<i4"},
+    {"chipID", "<i4"},
+    {"row", "<i4"},
+    {"col", "<i4"},
+    {"row_timestamp", "<i4"},
+    {"col_timestamp", "<i4"},
+    {"row_tot", "<i4"},
+    {"col_tot", "<i4"},
+    {"row_tot_us", "<f8"},
+    {"col_tot_us", "<f8"},
+    {"row_fpga_ts", "<i8"},
+    {"col_fpga_ts", "<i8"},
+};
+
+constexpr std::size_t kNumColumns = sizeof(kColumns) / sizeof(kColumns[0]);
+
+void writeRaw(std::FILE* f, const void* data, std::size_t size) {
+    if (std::fwrite(data, 1, size, f) != size) {
+        throw std::runtime_error("Short write on binary output file");
+    }
+}
+
+template <typename T, typename Getter>
+void writeColumn(std::FILE* f, const std::vector<MatchedHit>& hits,
+                 Getter get) {
+    std::vector<T> column(hits.size());
+    for (std::size_t i = 0; i < hits.size(); ++i) {
+        column[i] = get(hits[i]);
+    }
+    writeRaw(f, column.data(), column.size() * sizeof(T));
+}
+
+} // namespace
+
+void BinaryColumnWriter::writeMatchedHits(
+    const std::string& filename,
+    const std::vector<MatchedHit>& hits) {
+    std::FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+    std::setvbuf(f, nullptr, _IOFBF, kWriteBufferSize);
+
+    writeRaw(f, "RCMB", 4);
+    uint32_t version = 1;
+    uint32_t nCols = kNumColumns;
+    uint64_t nRows = hits.size();
+    writeRaw(f, &version, sizeof(version));
+    writeRaw(f, &nCols, sizeof(nCols));
+    writeRaw(f, &nRows, sizeof(nRows));
+    for (const auto& col : kColumns) {
+        uint8_t nameLen = std::strlen(col.name);
+        uint8_t dtypeLen = std::strlen(col.dtype);
+        writeRaw(f, &nameLen, 1);
+        writeRaw(f, col.name, nameLen);
+        writeRaw(f, &dtypeLen, 1);
+        writeRaw(f, col.dtype, dtypeLen);
+    }
+
+    writeColumn<int32_t>(f, hits, [](const MatchedHit& h) { return h.layer; });
+    writeColumn<int32_t>(f, hits, [](const MatchedHit& h) { return h.chipID; });
+    writeColumn<int32_t>(f, hits, [](const MatchedHit& h) { return h.row; });
+    writeColumn<int32_t>(f, hits, [](const MatchedHit& h) { return h.col; });
+    writeColumn<int32_t>(f, hits, [](const MatchedHit& h) { return h.row_timestamp; });
+    writeColumn<int32_t>(f, hits, [](const MatchedHit& h) { return h.col_timestamp; });
+    writeColumn<int32_t>(f, hits, [](const MatchedHit& h) { return h.row_tot; });
+    writeColumn<int32_t>(f, hits, [](const MatchedHit& h) { return h.col_tot; });
+    writeColumn<double>(f, hits, [](const MatchedHit& h) { return h.row_tot_us; });
+    writeColumn<double>(f, hits, [](const MatchedHit& h) { return h.col_tot_us; });
+    writeColumn<int64_t>(f, hits, [](const MatchedHit& h) { return h.row_fpga_ts; });
+    writeColumn<int64_t>(f, hits, [](const MatchedHit& h) { return h.col_fpga_ts; });
+
+    if (std::fclose(f) != 0) {
+        throw std::runtime_error("Cannot close output file: " + filename);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "data_structs.h"
+
+// Columnar binary output for matched hits, selected by --format binary.
+//
+// The CSV writer spends longer formatting fields than the matcher
+// spends matching them; this writer lays the data out as one contiguous
+// array per MatchedHit field behind a small self-describing header, so
+// downstream numpy/astropy loading is a single fromfile per column.
+//
+// Layout (all integers little-endian):
+//   'RCMB'                    4-byte magic
+//   uint32  version (1)
+//   uint32  number of columns
+//   uint64  number of rows
+//   per column: uint8 name length, name bytes,
+//               uint8 dtype length, numpy dtype string (e.g. '<i4')
+//   column data arrays, in header order
+class BinaryColumnWriter {
+public:
+    static void writeMatchedHits(
+        const std::string& filename,
+        const std::vector<MatchedHit>& hits
+    );
+};
@@ -0,0 +1,236 @@
+#include "checkpoint.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "csv_io.h"
+#include "filter.h"
+#include "stream.h"
+
+namespace {
+
+// On-disk checkpoint: 'RCMC' magic, version, the cut configuration it
+// was taken under (a resume with different cuts would silently corrupt
+// the output, so it is rejected), the input/output positions, and the
+// raw pending-hit buffers of every per-bucket matcher. HalfHit is a
+// trivially copyable record, so the buffers round-trip as raw bytes.
+constexpr char kMagic[4] = {'R', 'C', 'M', 'C'};
+constexpr std::uint32_t kVersion = 1;
+
+struct CheckpointHeader {
+    std::uint32_t version;
+    std::int32_t layers;
+    std::int32_t chips;
+    std::int32_t mints, maxts, mintot, maxtot;
+    std::uint64_t inputOffset;
+    std::uint64_t outputRows;
+    std::uint64_t nRead;
+    std::uint64_t nValid;
+};
+
+struct CheckpointState {
+    CheckpointHeader header{};
+    std::vector<std::vector<HalfHit>> pending;
+};
+
+std::string checkpointPath(const std::string& filename) {
+    return matchedOutputBase(filename) + "_matched.ckpt";
+}
+
+void readRaw(std::FILE* f, void* data, std::size_t size,
+             const std::string& path) {
+    if (std::fread(data, 1, size, f) != size) {
+        throw std::runtime_error("Truncated checkpoint: " + path);
+    }
+}
+
+void writeRaw(std::FILE* f, const void* data, std::size_t size,
+              const std::string& path) {
+    if (std::fwrite(data, 1, size, f) != size) {
+        throw std::runtime_error("Short write on checkpoint: " + path);
+    }
+}
+
+// Returns false if no checkpoint exists (first pass of a run).
+bool loadCheckpoint(const std::string& path, std::size_t nBuckets,
+                    CheckpointState& state) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    try {
+        char magic[4];
+        readRaw(f, magic, sizeof(magic), path);
+        if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error("Not a checkpoint file: " + path);
+        }
+        readRaw(f, &state.header, sizeof(state.header), path);
+        if (state.header.version != kVersion) {
+            throw std::runtime_error("Unsupported checkpoint version in: "
+                                     + path);
+        }
+        state.pending.resize(nBuckets);
+        for (std::size_t b = 0; b < nBuckets; ++b) {
+            std::uint64_t count = 0;
+            readRaw(f, &count, sizeof(count), path);
+            state.pending[b].resize(count);
+            readRaw(f, state.pending[b].data(), count * sizeof(HalfHit),
+                    path);
+        }
+    } catch (...) {
+        std::fclose(f);
+        throw;
+    }
+    std::fclose(f);
+    return true;
+}
+
+// Written to a temp file and renamed into place, so a crash mid-write
+// leaves the previous checkpoint intact.
+void saveCheckpoint(const std::string& path, const CheckpointState& state) {
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        throw std::runtime_error("Cannot open checkpoint: " + tmp);
+    }
+    try {
+        writeRaw(f, kMagic, sizeof(kMagic), tmp);
+        writeRaw(f, &state.header, sizeof(state.header), tmp);
+        for (const auto& buf : state.pending) {
+            std::uint64_t count = buf.size();
+            writeRaw(f, &count, sizeof(count), tmp);
+            writeRaw(f, buf.data(), count * sizeof(HalfHit), tmp);
+        }
+    } catch (...) {
+        std::fclose(f);
+        throw;
+    }
+    if (std::fclose(f) != 0 || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot finalize checkpoint: " + path);
+    }
+}
+
+} // namespace
+
+int processIncremental(const std::string& filename,
+                       const IncrementalOptions& opt) {
+    std::size_t nBuckets = static_cast<std::size_t>(opt.layers) * opt.chips;
+    std::string ckptPath = checkpointPath(filename);
+
+    CheckpointState state;
+    bool resumed = loadCheckpoint(ckptPath, nBuckets, state);
+    if (resumed) {
+        const auto& h = state.header;
+        if (h.layers != opt.layers || h.chips != opt.chips ||
+            h.mints != opt.fts.min || h.maxts != opt.fts.max ||
+            h.mintot != opt.ftot.min || h.maxtot != opt.ftot.max) {
+            std::cerr << "Checkpoint " << ckptPath
+                      << " was taken with different cuts; remove it to "
+                         "start over\n";
+            return 1;
+        }
+    } else {
+        state.pending.resize(nBuckets);
+    }
+
+    // Parse only the bytes the previous pass has not consumed.
+    std::size_t newOffset = 0;
+    auto data = CSVReader::readHalfHitsFrom(
+        filename, state.header.inputOffset, &newOffset);
+    if (newOffset < state.header.inputOffset) {
+        std::cerr << "Input shrank below the checkpoint offset; remove "
+                  << ckptPath << " to start over\n";
+        return 1;
+    }
+
+    // Restore the per-bucket matchers and feed them the new hits. The
+    // buffered tails are [rows..., cols...], so restoring them cannot
+    // close a burst early.
+    std::vector<StreamChipMatcher> matchers(
+        nBuckets, StreamChipMatcher(opt.fts, opt.ftot));
+    std::vector<std::vector<MatchedHit>> bucketOut(nBuckets);
+    for (std::size_t b = 0; b < nBuckets; ++b) {
+        matchers[b].restore(std::move(state.pending[b]));
+    }
+
+    ValidHalfHit valid;
+    std::size_t nValid = 0;
+    for (const auto& h : data) {
+        if (!valid(h)) {
+            continue;
+        }
+        ++nValid;
+        if (h.layer < 0 || h.layer >= opt.layers ||
+            h.chipID < 0 || h.chipID >= opt.chips) {
+            continue;
+        }
+        std::size_t b = h.layer * opt.chips + h.chipID;
+        matchers[b].add(h, bucketOut[b]);
+    }
+
+    if (opt.finalize) {
+        for (std::size_t b = 0; b < nBuckets; ++b) {
+            matchers[b].flush(bucketOut[b]);
+        }
+    }
+
+    // Append this pass's matches, layer-major as everywhere else, and
+    // continue the running row index from the checkpoint.
+    std::size_t newMatches = 0;
+    for (const auto& out : bucketOut) {
+        newMatches += out.size();
+    }
+    std::string outPath = matchedOutputBase(filename) + "_matched.csv";
+    if (resumed) {
+        CSVBatchWriter writer(outPath, state.header.outputRows);
+        for (const auto& out : bucketOut) {
+            writer.write(out);
+        }
+        writer.close();
+    } else {
+        CSVBatchWriter writer(outPath);
+        for (const auto& out : bucketOut) {
+            writer.write(out);
+        }
+        writer.close();
+    }
+
+    state.header.version = kVersion;
+    state.header.layers = opt.layers;
+    state.header.chips = opt.chips;
+    state.header.mints = opt.fts.min;
+    state.header.maxts = opt.fts.max;
+    state.header.mintot = opt.ftot.min;
+    state.header.maxtot = opt.ftot.max;
+    state.header.inputOffset = newOffset;
+    state.header.outputRows += newMatches;
+    state.header.nRead += data.size();
+    state.header.nValid += nValid;
+
+    if (opt.finalize) {
+        std::remove(ckptPath.c_str());
+    } else {
+        for (std::size_t b = 0; b < nBuckets; ++b) {
+            state.pending[b] = matchers[b].pending();
+        }
+        saveCheckpoint(ckptPath, state);
+    }
+
+    if (!opt.quiet) {
+        double pct = state.header.nRead == 0
+            ? 0.0 : 100.0 * state.header.nValid / state.header.nRead;
+        std::cout << data.size() << " new halfhits ("
+                  << state.header.nRead << " total, "
+                  << state.header.nValid << " valid, "
+                  << std::fixed << std::setprecision(2) << pct << "%), "
+                  << newMatches << " new matches ("
+                  << state.header.outputRows << " total)\n";
+        if (opt.finalize) {
+            std::cout << "Run finalized, checkpoint removed\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include "rowcolmatch.h"
+
+// Incremental append-mode processing for live runs (--incremental).
+//
+// The shift monitor re-runs rowcolmatch on a growing run CSV every few
+// minutes; reprocessing from the start makes each refresh O(run
+// length). This mode persists a checkpoint next to the output — input
+// byte offset, per-chip matcher tail state (the hits still waiting for
+// their column burst to close), output row count and the cut
+// configuration — so a rerun seeks straight to the new bytes and
+// appends only the new matches: O(new data) per refresh.
+//
+// Matches are appended in the order each pass produces them, so the
+// accumulated file can interleave buckets differently than a
+// from-scratch run; the match set is identical. Tail bursts stay
+// pending across passes until --finalize flushes them and removes the
+// checkpoint.
+
+struct IncrementalOptions {
+    int layers = 3;
+    int chips = 4;
+    WindowPredicate fts{0, 1};
+    WindowPredicate ftot{6, 15};
+    bool quiet = false;
+    // Flush the pending matcher tails and remove the checkpoint.
+    bool finalize = false;
+};
+
+// One incremental pass over `filename`; returns the process exit code.
+int processIncremental(const std::string& filename,
+                       const IncrementalOptions& opt);
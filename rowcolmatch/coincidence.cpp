@@ -0,0 +1,104 @@
+#include "coincidence.h"
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+
+// One cursor per bucket stream in the merge heap, ordered by the row
+// FPGA timestamp; ties break on the bucket index so the merge order is
+// deterministic.
+struct Cursor {
+    long long ts;
+    std::size_t bucket;
+    std::size_t idx;
+
+    bool operator>(const Cursor& other) const {
+        return ts != other.ts ? ts > other.ts : bucket > other.bucket;
+    }
+};
+
+void writeGroup(std::ofstream& file, std::size_t groupId,
+                const std::vector<const MatchedHit*>& group) {
+    for (const MatchedHit* h : group) {
+        file << groupId << ","
+             << h->layer << ","
+             << h->chipID << ","
+             << h->row << ","
+             << h->col << ","
+             << h->row_timestamp << ","
+             << h->col_timestamp << ","
+             << h->row_tot << ","
+             << h->col_tot << ","
+             << h->row_tot_us << ","
+             << h->col_tot_us << ","
+             << h->row_fpga_ts << ","
+             << h->col_fpga_ts << "\n";
+    }
+}
+
+} // namespace
+
+void writeCoincidences(const std::string& filename,
+                       const std::vector<std::vector<MatchedHit>>& buckets,
+                       const CoincidenceOptions& opt) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+    file << "group,layer,chipID,row,col,row_timestamp,col_timestamp,"
+         << "row_tot,col_tot,row_tot_us,col_tot_us,"
+         << "row_fpga_ts,col_fpga_ts\n";
+
+    std::priority_queue<Cursor, std::vector<Cursor>,
+                        std::greater<Cursor>> heap;
+    for (std::size_t b = 0; b < buckets.size(); ++b) {
+        if (!buckets[b].empty()) {
+            heap.push({buckets[b][0].row_fpga_ts, b, 0});
+        }
+    }
+
+    // Only the current candidate group is buffered, so memory stays
+    // bounded by the group size no matter how long the run is.
+    std::vector<const MatchedHit*> group;
+    long long groupStart = 0;
+    unsigned layerMask = 0;
+    std::size_t groupId = 0;
+
+    auto closeGroup = [&]() {
+        int nLayers = 0;
+        for (unsigned m = layerMask; m != 0; m >>= 1) {
+            nLayers += m & 1;
+        }
+        if (nLayers >= opt.minLayers) {
+            writeGroup(file, groupId++, group);
+        }
+        group.clear();
+        layerMask = 0;
+    };
+
+    while (!heap.empty()) {
+        Cursor cur = heap.top();
+        heap.pop();
+        const MatchedHit& h = buckets[cur.bucket][cur.idx];
+
+        if (!group.empty() && h.row_fpga_ts - groupStart > opt.window) {
+            closeGroup();
+        }
+        if (group.empty()) {
+            groupStart = h.row_fpga_ts;
+        }
+        group.push_back(&h);
+        if (h.layer >= 0 && h.layer < 32) {
+            layerMask |= 1u << h.layer;
+        }
+
+        if (cur.idx + 1 < buckets[cur.bucket].size()) {
+            heap.push({buckets[cur.bucket][cur.idx + 1].row_fpga_ts,
+                       cur.bucket, cur.idx + 1});
+        }
+    }
+    if (!group.empty()) {
+        closeGroup();
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "data_structs.h"
+
+// Second-stage cross-layer coincidence builder, enabled by --coinc.
+//
+// Each (layer, chip) partition emits its matches in FPGA-timestamp
+// order, so the per-bucket outputs are k sorted streams: a k-way merge
+// by row_fpga_ts yields the globally time-ordered hit sequence in
+// O(n log k) without ever materializing a resorted copy. Consecutive
+// merged hits within `window` FPGA ticks of the first hit of the
+// current group form a coincidence candidate; groups touching at least
+// `minLayers` distinct layers are written out.
+
+struct CoincidenceOptions {
+    // Group window in FPGA clock ticks, relative to the first hit.
+    long long window = 2;
+    // Minimum number of distinct layers a group must span.
+    int minLayers = 2;
+};
+
+// Merges the per-bucket match streams and writes the coincidence
+// groups as CSV: a group id column followed by the usual MatchedHit
+// columns, one row per member hit.
+void writeCoincidences(const std::string& filename,
+                       const std::vector<std::vector<MatchedHit>>& buckets,
+                       const CoincidenceOptions& opt);
@@ -3,6 +3,14 @@
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "mapped_file.h"
 
 bool stobool(std::string tmp) {
   if (tmp == "1" || tmp == "true" || tmp == "True") return true;
@@ -19,6 +27,15 @@ std::vector<HalfHit> CSVReader::readHalfHits(const std::string& filename) {
         throw std::runtime_error("Cannot open file: " + filename);
     }
 
+    // Size the vector from the byte count up front, with the same
+    // bytes-per-line estimate as the mapped readers.
+    file.seekg(0, std::ios::end);
+    auto bytes = file.tellg();
+    file.seekg(0);
+    if (bytes > 0) {
+        data.reserve(static_cast<std::size_t>(bytes) / 40);
+    }
+
     // Skip header
     std::getline(file, line);
 
@@ -47,35 +64,873 @@ std::vector<HalfHit> CSVReader::readHalfHits(const std::string& filename) {
     return data;
 }
 
+namespace {
+
+// In-place field parsers for the mapped reader: each consumes one
+// comma-terminated field starting at p (within [p, end)) and leaves p
+// just past the separator, without building any temporary strings.
+
+const char* fieldEnd(const char* p, const char* end) {
+    const char* sep = static_cast<const char*>(
+        std::memchr(p, ',', end - p));
+    return sep ? sep : end;
+}
+
+void skipField(const char*& p, const char* end) {
+    const char* sep = fieldEnd(p, end);
+    p = (sep < end) ? sep + 1 : end;
+}
+
+// Field validation is reported through this category code rather than
+// exceptions: the tolerant mode needs to keep going past bad rows, and
+// a throw-free per-row path optimizes better even in strict mode.
+enum class ParseError { None, Truncated, BadNumber, BadBool };
+
+template <typename T>
+ParseError tryParseField(const char*& p, const char* end, T& value) {
+    if (p == end) {
+        return ParseError::Truncated;
+    }
+    const char* sep = fieldEnd(p, end);
+    auto [ptr, ec] = std::from_chars(p, sep, value);
+    // Require the whole field to convert: from_chars alone would accept
+    // "12\0 34" as 12, silently truncating a value around a stray NUL.
+    if (ec != std::errc() || ptr != sep) {
+        return ParseError::BadNumber;
+    }
+    p = (sep < end) ? sep + 1 : end;
+    return ParseError::None;
+}
+
+ParseError tryParseBoolField(const char*& p, const char* end, int& value) {
+    if (p == end) {
+        return ParseError::Truncated;
+    }
+    const char* sep = fieldEnd(p, end);
+    std::size_t len = sep - p;
+    if (len >= 1 && (p[0] == '1' || p[0] == 't' || p[0] == 'T')) value = 1;
+    else if (len >= 1 && (p[0] == '0' || p[0] == 'f' || p[0] == 'F')) value = 0;
+    else return ParseError::BadBool;
+    p = (sep < end) ? sep + 1 : end;
+    return ParseError::None;
+}
+
+// Parses one CSV row laid out as in readHalfHits; [p, end) must span
+// exactly the line, without the trailing newline.
+ParseError tryParseHalfHitLine(const char* p, const char* end, HalfHit& h) {
+    ParseError err;
+    skipField(p, end);                       // line number
+    skipField(p, end);                       // readout
+    if ((err = tryParseField(p, end, h.layer)) != ParseError::None) return err;
+    if ((err = tryParseField(p, end, h.chipID)) != ParseError::None) return err;
+    if ((err = tryParseField(p, end, h.payload)) != ParseError::None) return err;
+    if ((err = tryParseField(p, end, h.location)) != ParseError::None) return err;
+    if ((err = tryParseBoolField(p, end, h.isCol)) != ParseError::None) return err;
+    if ((err = tryParseField(p, end, h.timestamp)) != ParseError::None) return err;
+    skipField(p, end);                       // ToT MSB
+    skipField(p, end);                       // ToT LSB
+    if ((err = tryParseField(p, end, h.tot_total)) != ParseError::None) return err;
+    if ((err = tryParseField(p, end, h.tot_us)) != ParseError::None) return err;
+    return tryParseField(p, end, h.fpga_ts);
+}
+
+const char* parseErrorLabel(ParseError err) {
+    switch (err) {
+    case ParseError::Truncated: return "truncated row";
+    case ParseError::BadNumber: return "bad numeric field";
+    case ParseError::BadBool:   return "bad boolean field";
+    default:                    return "ok";
+    }
+}
+
+// Strict wrapper: any malformed row aborts the run.
+HalfHit parseHalfHitLine(const char* p, const char* end) {
+    HalfHit h;
+    ParseError err = tryParseHalfHitLine(p, end, h);
+    if (err != ParseError::None) {
+        throw std::invalid_argument(
+            std::string("parseHalfHitLine: ") + parseErrorLabel(err) +
+            " in '" + std::string(p, end) + "'");
+    }
+    return h;
+}
+
+// Parses every complete line in [p, end) into out.
+void parseHalfHitRange(const char* p, const char* end,
+                       std::vector<HalfHit>& out) {
+    while (p < end) {
+        const char* nl = static_cast<const char*>(
+            std::memchr(p, '\n', end - p));
+        const char* lineEnd = nl ? nl : end;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+        if (lineEnd > p) {
+            out.push_back(parseHalfHitLine(p, lineEnd));
+        }
+        p = nl ? nl + 1 : end;
+    }
+}
+
+// Tolerant counterpart of parseHalfHitRange: rejected rows are counted
+// per category and appended verbatim (newline-terminated) to the
+// quarantine buffer instead of throwing.
+void parseHalfHitRangeTolerant(const char* p, const char* end,
+                               std::vector<HalfHit>& out,
+                               ParseErrorStats& stats,
+                               std::string& quarantine) {
+    while (p < end) {
+        const char* nl = static_cast<const char*>(
+            std::memchr(p, '\n', end - p));
+        const char* rawEnd = nl ? nl : end;
+        const char* lineEnd = rawEnd;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+        if (lineEnd > p) {
+            HalfHit h;
+            ParseError err = tryParseHalfHitLine(p, lineEnd, h);
+            if (err == ParseError::None) {
+                out.push_back(h);
+            } else {
+                if (err == ParseError::Truncated) ++stats.truncated;
+                else if (err == ParseError::BadNumber) ++stats.badNumber;
+                else ++stats.badBool;
+                quarantine.append(p, rawEnd - p);
+                quarantine.push_back('\n');
+            }
+        }
+        p = nl ? nl + 1 : end;
+    }
+}
+
+// Splits [begin, end) into up to nThreads byte ranges, snapping each
+// boundary forward to the next newline so no line straddles two
+// workers. Returns the range boundaries, bounds[i]..bounds[i+1].
+std::vector<const char*> newlineBounds(const char* begin, const char* end,
+                                       unsigned nThreads) {
+    std::vector<const char*> bounds;
+    bounds.push_back(begin);
+    std::size_t span = end - begin;
+    for (unsigned i = 1; i < nThreads; ++i) {
+        const char* cut = begin + span * i / nThreads;
+        if (cut <= bounds.back()) {
+            continue;
+        }
+        const char* nl = static_cast<const char*>(
+            std::memchr(cut, '\n', end - cut));
+        cut = nl ? nl + 1 : end;
+        if (cut > bounds.back() && cut < end) {
+            bounds.push_back(cut);
+        }
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+// Returns the start of the data rows, i.e. the mapped buffer with the
+// header line stripped.
+const char* skipHeader(const MappedFile& map) {
+    const char* nl = static_cast<const char*>(
+        std::memchr(map.data, '\n', map.size));
+    return nl ? nl + 1 : map.data + map.size;
+}
+
+} // namespace
+
+HalfHit CSVReader::parseLine(const char* p, const char* end) {
+    return parseHalfHitLine(p, end);
+}
+
+bool CSVReader::isRegularFile(const std::string& filename) {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+std::vector<HalfHit> CSVReader::readHalfHitsMapped(const std::string& filename) {
+    MappedFile map(filename);
+
+    std::vector<HalfHit> data;
+    if (map.size == 0) {
+        return data;
+    }
+    // Rough row-size estimate to avoid reallocation churn while growing.
+    data.reserve(map.size / 40);
+
+    parseHalfHitRange(skipHeader(map), map.data + map.size, data);
+    return data;
+}
+
+std::vector<HalfHit> CSVReader::readHalfHitsParallel(const std::string& filename,
+                                                     unsigned nThreads) {
+    if (nThreads <= 1) {
+        return readHalfHitsMapped(filename);
+    }
+
+    MappedFile map(filename);
+    if (map.size == 0) {
+        return {};
+    }
+
+    const char* begin = skipHeader(map);
+    const char* end = map.data + map.size;
+
+    std::vector<const char*> bounds = newlineBounds(begin, end, nThreads);
+    std::size_t nRanges = bounds.size() - 1;
+    std::vector<std::vector<HalfHit>> partial(nRanges);
+    std::vector<std::thread> workers;
+    workers.reserve(nRanges);
+    for (std::size_t i = 0; i < nRanges; ++i) {
+        workers.emplace_back([&, i]() {
+            partial[i].reserve((bounds[i + 1] - bounds[i]) / 40);
+            parseHalfHitRange(bounds[i], bounds[i + 1], partial[i]);
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    // Stitch the per-range results back in file order.
+    std::size_t total = 0;
+    for (const auto& part : partial) {
+        total += part.size();
+    }
+    std::vector<HalfHit> data;
+    data.reserve(total);
+    for (auto& part : partial) {
+        data.insert(data.end(), part.begin(), part.end());
+    }
+    return data;
+}
+
+std::vector<HalfHit> CSVReader::readHalfHitsTolerant(
+    const std::string& filename, unsigned nThreads,
+    const std::string& quarantinePath, ParseErrorStats& stats) {
+    MappedFile map(filename);
+    if (map.size == 0) {
+        return {};
+    }
+
+    const char* begin = skipHeader(map);
+    const char* end = map.data + map.size;
+
+    std::vector<const char*> bounds =
+        newlineBounds(begin, end, nThreads > 0 ? nThreads : 1);
+    std::size_t nRanges = bounds.size() - 1;
+    std::vector<std::vector<HalfHit>> partial(nRanges);
+    std::vector<ParseErrorStats> partialStats(nRanges);
+    std::vector<std::string> partialQuarantine(nRanges);
+
+    auto parseRange = [&](std::size_t i) {
+        partial[i].reserve((bounds[i + 1] - bounds[i]) / 40);
+        parseHalfHitRangeTolerant(bounds[i], bounds[i + 1], partial[i],
+                                  partialStats[i], partialQuarantine[i]);
+    };
+    if (nRanges > 1) {
+        std::vector<std::thread> workers;
+        workers.reserve(nRanges);
+        for (std::size_t i = 0; i < nRanges; ++i) {
+            workers.emplace_back(parseRange, i);
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    } else {
+        parseRange(0);
+    }
+
+    // Stitch results, counts and quarantined rows back in file order.
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < nRanges; ++i) {
+        total += partial[i].size();
+        stats.truncated += partialStats[i].truncated;
+        stats.badNumber += partialStats[i].badNumber;
+        stats.badBool += partialStats[i].badBool;
+    }
+    std::vector<HalfHit> data;
+    data.reserve(total);
+    for (auto& part : partial) {
+        data.insert(data.end(), part.begin(), part.end());
+    }
+
+    if (stats.total() > 0) {
+        std::ofstream quarantine(quarantinePath);
+        if (!quarantine.is_open()) {
+            throw std::runtime_error("Cannot open quarantine file: " +
+                                     quarantinePath);
+        }
+        for (const auto& rows : partialQuarantine) {
+            quarantine << rows;
+        }
+    }
+    return data;
+}
+
+namespace {
+
+// --- fast CSV formatting ---
+//
+// Per-field `operator<<` pays locale and virtual streambuf costs on
+// every value; rows are instead formatted into a block buffer with the
+// helpers below and flushed with raw megabyte writes.
+
+constexpr std::size_t kCsvWriteBlock = 1 << 20;
+// Generous bound on one formatted row (13 fields of at most ~20 chars).
+constexpr std::size_t kCsvMaxRow = 320;
+
+char* formatUnsigned(char* p, unsigned long long v) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+char* formatInt(char* p, long long v) {
+    unsigned long long u = static_cast<unsigned long long>(v);
+    if (v < 0) {
+        *p++ = '-';
+        u = 0ULL - u;
+    }
+    return formatUnsigned(p, u);
+}
+
+// Doubles keep going through %g: it is byte-identical to the default
+// ostream formatting the downstream tooling already consumes, which a
+// fixed-precision path would not be.
+char* formatDouble(char* p, double v) {
+    return p + std::snprintf(p, 32, "%g", v);
+}
+
+} // namespace
+
+std::vector<HalfHit> CSVReader::readHalfHitsFrom(
+    const std::string& filename, std::size_t offset,
+    std::size_t* newOffset) {
+    MappedFile map(filename);
+    std::vector<HalfHit> data;
+    if (offset >= map.size) {
+        // Report the real file size, not the requested offset, so a
+        // caller resuming from a stored offset can see that the input
+        // shrank beneath it.
+        *newOffset = map.size;
+        return data;
+    }
+
+    const char* begin = map.data + offset;
+    if (offset == 0) {
+        begin = skipHeader(map);
+    }
+    const char* end = map.data + map.size;
+
+    // Only complete lines are consumed; the writer may still be mid-row
+    // at EOF, so everything after the last newline waits for the next
+    // pass.
+    const char* last = end;
+    while (last > begin && last[-1] != '\n') {
+        --last;
+    }
+    if (last == begin) {
+        *newOffset = begin - map.data;
+        return data;
+    }
+
+    data.reserve((last - begin) / 40);
+    parseHalfHitRange(begin, last, data);
+    *newOffset = last - map.data;
+    return data;
+}
+
+std::string matchedOutputBase(const std::string& filename) {
+    std::string base = filename;
+    if (base.size() > 3 && base.compare(base.size() - 3, 3, ".gz") == 0) {
+        base.resize(base.size() - 3);
+    }
+    std::size_t slash = base.find_last_of('/');
+    std::size_t dot = base.find_last_of('.');
+    if (dot != std::string::npos &&
+        (slash == std::string::npos || dot > slash)) {
+        base.resize(dot);
+    }
+    return base;
+}
+
 void CSVWriter::writeMatchedHits(
     const std::string& filename,
     const std::vector<MatchedHit>& hits
 ) {
-    std::ofstream file(filename);
+    CSVBatchWriter writer(filename);
+    writer.write(hits);
+    writer.close();
+}
 
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open output file: " + filename);
+CSVBatchWriter::CSVBatchWriter(const std::string& filename)
+    : filename_(filename),
+      file_(std::fopen(filename.c_str(), "wb")),
+      block_(kCsvWriteBlock) {
+    if (!file_) {
+        throw std::runtime_error("Cannot open output file: " + filename_);
     }
+    cursor_ = block_.data();
 
     // Header
-    file << ",layer,chipID,row,col,row_timestamp,col_timestamp,"
-         << "row_tot,col_tot,row_tot_us,col_tot_us,"
-         << "row_fpga_ts,col_fpga_ts\n";
-
-    for (std::size_t i = 0; i < hits.size(); ++i) {
-        auto const& h = hits[i];
-        file << i << ","
-             << h.layer << ","
-             << h.chipID << ","
-             << h.row << ","
-             << h.col << ","
-             << h.row_timestamp << ","
-             << h.col_timestamp << ","
-             << h.row_tot << ","
-             << h.col_tot << ","
-             << h.row_tot_us << ","
-             << h.col_tot_us << ","
-             << h.row_fpga_ts << ","
-             << h.col_fpga_ts << "\n";
+    static const char header[] =
+        ",layer,chipID,row,col,row_timestamp,col_timestamp,"
+        "row_tot,col_tot,row_tot_us,col_tot_us,"
+        "row_fpga_ts,col_fpga_ts\n";
+    std::memcpy(cursor_, header, sizeof(header) - 1);
+    cursor_ += sizeof(header) - 1;
+}
+
+CSVBatchWriter::CSVBatchWriter(const std::string& filename,
+                               std::size_t startIndex)
+    : filename_(filename),
+      file_(std::fopen(filename.c_str(), "ab")),
+      block_(kCsvWriteBlock),
+      nextIndex_(startIndex) {
+    if (!file_) {
+        throw std::runtime_error("Cannot open output file: " + filename_);
+    }
+    cursor_ = block_.data();
+}
+
+CSVBatchWriter::~CSVBatchWriter() {
+    if (file_) {
+        // Best effort on the unwinding path; close() reports errors.
+        std::fwrite(block_.data(), 1, cursor_ - block_.data(), file_);
+        std::fclose(file_);
+    }
+}
+
+void CSVBatchWriter::flushBlock() {
+    std::size_t used = cursor_ - block_.data();
+    if (std::fwrite(block_.data(), 1, used, file_) != used) {
+        throw std::runtime_error("Short write on output file: " + filename_);
+    }
+    cursor_ = block_.data();
+}
+
+void CSVBatchWriter::write(const std::vector<MatchedHit>& hits) {
+    for (const auto& h : hits) {
+        if (static_cast<std::size_t>(block_.data() + block_.size() - cursor_)
+                < kCsvMaxRow) {
+            flushBlock();
+        }
+        char* p = cursor_;
+        p = formatUnsigned(p, nextIndex_++);   *p++ = ',';
+        p = formatInt(p, h.layer);             *p++ = ',';
+        p = formatInt(p, h.chipID);            *p++ = ',';
+        p = formatInt(p, h.row);               *p++ = ',';
+        p = formatInt(p, h.col);               *p++ = ',';
+        p = formatInt(p, h.row_timestamp);     *p++ = ',';
+        p = formatInt(p, h.col_timestamp);     *p++ = ',';
+        p = formatInt(p, h.row_tot);           *p++ = ',';
+        p = formatInt(p, h.col_tot);           *p++ = ',';
+        p = formatDouble(p, h.row_tot_us);     *p++ = ',';
+        p = formatDouble(p, h.col_tot_us);     *p++ = ',';
+        p = formatInt(p, h.row_fpga_ts);       *p++ = ',';
+        p = formatInt(p, h.col_fpga_ts);       *p++ = '\n';
+        cursor_ = p;
+    }
+}
+
+void CSVBatchWriter::close() {
+    flushBlock();
+    std::FILE* f = file_;
+    file_ = nullptr;
+    if (std::fclose(f) != 0) {
+        throw std::runtime_error("Cannot close output file: " + filename_);
+    }
+}
+
+namespace {
+
+// Compression magic bytes: gzip (RFC 1952) and zstd (RFC 8878). zstd
+// is recognized only to produce a useful error, since this build links
+// zlib alone.
+bool hasMagic(const std::string& filename,
+              const unsigned char* magic, std::size_t len) {
+    std::ifstream file(filename, std::ios::binary);
+    unsigned char head[4] = {0, 0, 0, 0};
+    file.read(reinterpret_cast<char*>(head), len);
+    return file.gcount() == static_cast<std::streamsize>(len) &&
+           std::memcmp(head, magic, len) == 0;
+}
+
+constexpr unsigned char kGzipMagic[] = {0x1f, 0x8b};
+constexpr unsigned char kZstdMagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+bool isGzipFile(const std::string& filename) {
+    return hasMagic(filename, kGzipMagic, sizeof(kGzipMagic));
+}
+
+bool isZstdFile(const std::string& filename) {
+    return hasMagic(filename, kZstdMagic, sizeof(kZstdMagic));
+}
+
+} // namespace
+
+bool CSVReader::isCompressed(const std::string& filename) {
+    // Probing magic bytes consumes data on fifos and other one-shot
+    // streams, so only regular files are ever sniffed.
+    return isRegularFile(filename) &&
+           (isGzipFile(filename) || isZstdFile(filename));
+}
+
+std::vector<HalfHit> CSVReader::readHalfHitsCompressed(
+    const std::string& filename) {
+    auto source = openHalfHitChunkSource(filename);
+    std::vector<HalfHit> data;
+    std::vector<HalfHit> chunk;
+    while (source->next(chunk)) {
+        data.insert(data.end(), chunk.begin(), chunk.end());
+    }
+    return data;
+}
+
+std::unique_ptr<HalfHitChunkSource> openHalfHitChunkSource(
+    const std::string& filename) {
+    if (!CSVReader::isRegularFile(filename)) {
+        return std::make_unique<CSVChunkReader>(filename);
+    }
+    if (isZstdFile(filename)) {
+        throw std::runtime_error(
+            "zstd input needs libzstd, which this build lacks; "
+            "recompress as gzip: " + filename);
+    }
+    if (isGzipFile(filename)) {
+        return std::make_unique<GzipChunkReader>(filename);
+    }
+    return std::make_unique<CSVChunkReader>(filename);
+}
+
+CSVChunkReader::CSVChunkReader(const std::string& filename,
+                               std::size_t chunkBytes)
+    : filename_(filename), chunkBytes_(chunkBytes) {
+    // Opened once, here, and handed to the I/O thread: fifos and other
+    // one-shot streams do not survive a probe open/close cycle.
+    file_ = std::fopen(filename_.c_str(), "rb");
+    if (!file_) {
+        throw std::runtime_error("Cannot open file: " + filename_);
+    }
+    ioThread_ = std::thread([this]() { readLoop(); });
+}
+
+CSVChunkReader::~CSVChunkReader() {
+    // Unblock the I/O thread if the consumer stopped early; push() on
+    // a closed queue discards.
+    blocks_.close();
+    if (ioThread_.joinable()) {
+        ioThread_.join();
+    }
+}
+
+void CSVChunkReader::readLoop() {
+    posix_fadvise(fileno(file_), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    while (true) {
+        std::string block(chunkBytes_, '\0');
+        std::size_t got = std::fread(&block[0], 1, chunkBytes_, file_);
+        if (got == 0) {
+            break;
+        }
+        block.resize(got);
+        blocks_.push(std::move(block));
+    }
+    std::fclose(file_);
+    blocks_.close();
+}
+
+bool CSVChunkReader::next(std::vector<HalfHit>& out) {
+    out.clear();
+    if (done_) {
+        return false;
+    }
+
+    std::string block;
+    if (!blocks_.pop(block)) {
+        done_ = true;
+        // Trailing partial line without a final newline.
+        if (!carry_.empty()) {
+            parseHalfHitRange(carry_.data(), carry_.data() + carry_.size(),
+                              out);
+            carry_.clear();
+            return true;
+        }
+        return false;
+    }
+
+    // Stitch the carried partial line onto this block, then hold back
+    // everything after the last complete line for the next call.
+    carry_ += block;
+    std::size_t lastNl = carry_.rfind('\n');
+    if (lastNl == std::string::npos) {
+        return true;
+    }
+
+    const char* p = carry_.data();
+    const char* end = p + lastNl + 1;
+    if (!headerSkipped_) {
+        const char* nl = static_cast<const char*>(
+            std::memchr(p, '\n', end - p));
+        p = nl ? nl + 1 : end;
+        headerSkipped_ = true;
+    }
+    parseHalfHitRange(p, end, out);
+    carry_.erase(0, lastNl + 1);
+    return true;
+}
+
+std::vector<HalfHit> CSVReader::readHalfHitsPrefetch(
+    const std::string& filename, unsigned nThreads) {
+    // Opened once and handed to the I/O thread (see CSVChunkReader).
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+
+    struct Block {
+        std::size_t seq = 0;
+        std::string bytes;
+    };
+    BoundedQueue<Block> blocks(4);
+
+    // I/O thread: large sequential reads, snapped to line boundaries
+    // so every block parses independently; the header goes with the
+    // first block.
+    std::thread io([&]() {
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        constexpr std::size_t kReadBytes = 8 * 1024 * 1024;
+        std::string carry;
+        std::size_t seq = 0;
+        bool headerSkipped = false;
+        while (true) {
+            std::string buf(kReadBytes, '\0');
+            std::size_t got = std::fread(&buf[0], 1, kReadBytes, file);
+            if (got == 0) {
+                break;
+            }
+            buf.resize(got);
+            carry += buf;
+            std::size_t lastNl = carry.rfind('\n');
+            if (lastNl == std::string::npos) {
+                continue;
+            }
+            std::string block = carry.substr(0, lastNl + 1);
+            carry.erase(0, lastNl + 1);
+            if (!headerSkipped) {
+                std::size_t nl = block.find('\n');
+                block.erase(0, nl == std::string::npos ? block.size()
+                                                       : nl + 1);
+                headerSkipped = true;
+            }
+            if (!block.empty()) {
+                blocks.push({seq++, std::move(block)});
+            }
+        }
+        if (!carry.empty()) {
+            blocks.push({seq++, std::move(carry)});
+        }
+        std::fclose(file);
+        blocks.close();
+    });
+
+    // Parser workers: each parses whole blocks and files the result
+    // under its sequence number, so the stitch below restores file
+    // order no matter which worker got which block.
+    std::mutex mutex;
+    std::vector<std::vector<HalfHit>> parsed;
+    std::string error;
+    auto parseBlocks = [&]() {
+        Block block;
+        while (blocks.pop(block)) {
+            try {
+                std::vector<HalfHit> hits;
+                hits.reserve(block.bytes.size() / 40);
+                parseHalfHitRange(block.bytes.data(),
+                                  block.bytes.data() + block.bytes.size(),
+                                  hits);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (parsed.size() <= block.seq) {
+                    parsed.resize(block.seq + 1);
+                }
+                parsed[block.seq] = std::move(hits);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error.empty()) {
+                    error = e.what();
+                }
+            }
+        }
+    };
+
+    unsigned nWorkers = nThreads > 0 ? nThreads : 1;
+    std::vector<std::thread> workers;
+    workers.reserve(nWorkers - 1);
+    for (unsigned w = 1; w < nWorkers; ++w) {
+        workers.emplace_back(parseBlocks);
+    }
+    parseBlocks();
+    io.join();
+    for (auto& t : workers) {
+        t.join();
+    }
+    if (!error.empty()) {
+        throw std::invalid_argument(error);
+    }
+
+    std::size_t total = 0;
+    for (const auto& part : parsed) {
+        total += part.size();
+    }
+    std::vector<HalfHit> data;
+    data.reserve(total);
+    for (auto& part : parsed) {
+        data.insert(data.end(), part.begin(), part.end());
+    }
+    return data;
+}
+
+GzipChunkReader::GzipChunkReader(const std::string& filename,
+                                 std::size_t chunkBytes)
+    : filename_(filename), chunkBytes_(chunkBytes) {
+    // Fail fast on the calling thread; the decompressor reopens it.
+    std::ifstream probe(filename_, std::ios::binary);
+    if (!probe.is_open()) {
+        throw std::runtime_error("Cannot open file: " + filename_);
+    }
+    decompressor_ = std::thread([this]() { decompressLoop(); });
+}
+
+GzipChunkReader::~GzipChunkReader() {
+    // Unblock the decompressor if the consumer stopped early; push()
+    // on a closed queue discards.
+    queue_.close();
+    if (decompressor_.joinable()) {
+        decompressor_.join();
+    }
+}
+
+void GzipChunkReader::setError(const std::string& message) {
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    if (error_.empty()) {
+        error_ = message;
+    }
+}
+
+void GzipChunkReader::decompressLoop() {
+    std::FILE* file = std::fopen(filename_.c_str(), "rb");
+    if (!file) {
+        setError("Cannot open file: " + filename_);
+        queue_.close();
+        return;
+    }
+
+    z_stream strm{};
+    // 15 + 32: max window, with automatic gzip/zlib header detection.
+    if (inflateInit2(&strm, 15 + 32) != Z_OK) {
+        setError("inflateInit2 failed for: " + filename_);
+        std::fclose(file);
+        queue_.close();
+        return;
+    }
+
+    std::vector<unsigned char> in(1 << 20);
+    std::string out;
+    bool eof = false;
+    int ret = Z_OK;
+
+    while (!eof || strm.avail_in > 0) {
+        if (strm.avail_in == 0) {
+            std::size_t got = std::fread(in.data(), 1, in.size(), file);
+            if (got == 0) {
+                if (std::ferror(file)) {
+                    setError("Read error on: " + filename_);
+                } else if (ret != Z_STREAM_END) {
+                    setError("Truncated gzip stream: " + filename_);
+                }
+                break;
+            }
+            strm.next_in = in.data();
+            strm.avail_in = static_cast<uInt>(got);
+            eof = std::feof(file);
+        }
+
+        out.resize(chunkBytes_);
+        strm.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        strm.avail_out = static_cast<uInt>(chunkBytes_);
+        ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            setError("Corrupt gzip stream (" +
+                     std::string(strm.msg ? strm.msg : "inflate failed") +
+                     "): " + filename_);
+            break;
+        }
+        out.resize(chunkBytes_ - strm.avail_out);
+        if (!out.empty()) {
+            queue_.push(std::move(out));
+            out = {};
+        }
+        if (ret == Z_STREAM_END) {
+            // Concatenated members (pigz and `cat a.gz b.gz` both
+            // produce them): reset and keep inflating.
+            if (strm.avail_in > 0 || !eof) {
+                inflateReset2(&strm, 15 + 32);
+            } else {
+                break;
+            }
+        }
+    }
+
+    inflateEnd(&strm);
+    std::fclose(file);
+    queue_.close();
+}
+
+bool GzipChunkReader::next(std::vector<HalfHit>& out) {
+    out.clear();
+    if (done_) {
+        return false;
+    }
+
+    std::string chunk;
+    if (!queue_.pop(chunk)) {
+        done_ = true;
+        {
+            std::lock_guard<std::mutex> lock(errorMutex_);
+            if (!error_.empty()) {
+                throw std::runtime_error(error_);
+            }
+        }
+        // Trailing partial line without a final newline.
+        if (!carry_.empty()) {
+            parseHalfHitRange(carry_.data(), carry_.data() + carry_.size(),
+                              out);
+            carry_.clear();
+            return true;
+        }
+        return false;
+    }
+
+    // Same stitching as CSVChunkReader: carry the partial trailing
+    // line, hand everything up to the last complete one to the parser.
+    carry_ += chunk;
+    std::size_t lastNl = carry_.rfind('\n');
+    if (lastNl == std::string::npos) {
+        return true;
+    }
+
+    const char* p = carry_.data();
+    const char* end = p + lastNl + 1;
+    if (!headerSkipped_) {
+        const char* nl = static_cast<const char*>(
+            std::memchr(p, '\n', end - p));
+        p = nl ? nl + 1 : end;
+        headerSkipped_ = true;
     }
+    parseHalfHitRange(p, end, out);
+    carry_.erase(0, lastNl + 1);
+    return true;
 }
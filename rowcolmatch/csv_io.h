@@ -1,13 +1,173 @@
 #pragma once
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
+#include "bounded_queue.h"
 #include "data_structs.h"
 
+// Per-category accounting for rows rejected by the tolerant parse mode
+// (--tolerant), reported in the run summary.
+struct ParseErrorStats {
+    std::size_t truncated = 0;   // row ended before its last field
+    std::size_t badNumber = 0;   // a numeric field failed to convert
+    std::size_t badBool = 0;     // the isCol field was not a boolean
+    std::size_t total() const { return truncated + badNumber + badBool; }
+};
+
 class CSVReader {
 public:
     static std::vector<HalfHit> readHalfHits(const std::string& filename);
+    // Zero-copy variant: maps the whole file and parses fields in place,
+    // avoiding the per-line string/stringstream allocations of readHalfHits.
+    // Only works on regular (seekable) files.
+    static std::vector<HalfHit> readHalfHitsMapped(const std::string& filename);
+    // Parallel variant of readHalfHitsMapped: splits the mapping into
+    // nThreads newline-aligned byte ranges, parses each range in a worker
+    // thread and stitches the per-range results back in file order.
+    static std::vector<HalfHit> readHalfHitsParallel(const std::string& filename,
+                                                     unsigned nThreads);
+    // Tolerant variant of readHalfHitsParallel: a malformed row is
+    // counted per category in stats and appended verbatim to the
+    // quarantine file (created only if at least one row is rejected)
+    // instead of aborting the run. Field validation never throws, so
+    // the well-formed fast path stays branch-predictable.
+    static std::vector<HalfHit> readHalfHitsTolerant(
+        const std::string& filename, unsigned nThreads,
+        const std::string& quarantinePath, ParseErrorStats& stats);
+    // Parses the single CSV row spanning [p, end), without the trailing
+    // newline; used by the shard reader, which walks lines itself.
+    static HalfHit parseLine(const char* p, const char* end);
+    // True if the path refers to a regular file that can be mmap'ed.
+    static bool isRegularFile(const std::string& filename);
+    // True if the file starts with a known compression magic (gzip or
+    // zstd); such inputs go through readHalfHitsCompressed.
+    static bool isCompressed(const std::string& filename);
+    // Reads a compressed run CSV end to end, decompressing on a
+    // dedicated thread while this one parses.
+    static std::vector<HalfHit> readHalfHitsCompressed(
+        const std::string& filename);
+    // Read-ahead variant for inputs that cannot be mmap'ed (pipes,
+    // some network filesystems): an I/O thread streams newline-aligned
+    // blocks to nThreads parser workers, and the per-block results are
+    // stitched back in file order.
+    static std::vector<HalfHit> readHalfHitsPrefetch(
+        const std::string& filename, unsigned nThreads);
+    // Parses the complete lines from byte `offset` to EOF and sets
+    // newOffset just past the last complete line, so a growing file
+    // can be consumed incrementally. Skips the header when offset is 0.
+    // newOffset never exceeds the current file size: an offset past
+    // EOF comes back smaller than it went in, which is how the
+    // checkpoint path detects a shrunken input.
+    static std::vector<HalfHit> readHalfHitsFrom(
+        const std::string& filename, std::size_t offset,
+        std::size_t* newOffset);
+};
+
+// Reader for the native .apx binary readout format written by the DAQ
+// (see astropix_analysis/fileio.py): '%APXDF' magic, a length-prefixed
+// JSON header carrying the readout class uid, then a sequence of
+// readout records, each holding a raw chip byte stream. Hits are
+// decoded straight into HalfHit records, cutting out the CSV
+// intermediate entirely.
+class ApxReader {
+public:
+    static constexpr const char* EXTENSION = ".apx";
+
+    // True if the path has the .apx extension.
+    static bool isApxFile(const std::string& filename);
+    static std::vector<HalfHit> readHalfHits(const std::string& filename);
+
+    // Decodes one readout record as sent over UDP by apx_udpsend.py
+    // (the to_bytes() layout: fe dc ba header, readout id, FPGA
+    // timestamp, length, raw chip bytes) and appends the decoded
+    // halfhits. carry holds a hit word truncated at the record
+    // boundary, exactly as in the file reader. Returns false on a
+    // malformed datagram, which the caller should drop and count.
+    static bool decodeDatagram(const unsigned char* data, std::size_t size,
+                               std::string& carry,
+                               std::vector<HalfHit>& out);
 };
 
+// Incremental source of half-hit chunks for the streaming pipeline:
+// yields hits a fixed-size byte chunk at a time instead of
+// materializing the whole file, so peak memory is independent of the
+// input size. next() may legitimately yield an empty chunk; only a
+// false return means the input is exhausted.
+class HalfHitChunkSource {
+public:
+    virtual ~HalfHitChunkSource() = default;
+    // Appends the hits of the next chunk to out (cleared first);
+    // returns false once the input is exhausted.
+    virtual bool next(std::vector<HalfHit>& out) = 0;
+};
+
+// Plain-file chunk source with read-ahead: a dedicated I/O thread
+// issues large sequential reads (hinted with posix_fadvise) into a
+// small pool of rotating blocks, so the parser consumes one block
+// while the next is already in flight and parse time and I/O time
+// overlap instead of adding.
+class CSVChunkReader : public HalfHitChunkSource {
+public:
+    explicit CSVChunkReader(const std::string& filename,
+                            std::size_t chunkBytes = 8 * 1024 * 1024);
+    ~CSVChunkReader() override;
+    bool next(std::vector<HalfHit>& out) override;
+
+private:
+    void readLoop();
+
+    std::string filename_;
+    std::size_t chunkBytes_;
+    std::FILE* file_ = nullptr;
+    BoundedQueue<std::string> blocks_{3};
+    std::thread ioThread_;
+    std::string carry_;
+    bool headerSkipped_ = false;
+    bool done_ = false;
+};
+
+// Chunk source for gzip-compressed run CSVs: a dedicated thread runs
+// zlib inflate and feeds decompressed blocks through a bounded queue,
+// so decompression overlaps parsing and no scratch file is needed.
+// Multi-member streams (pigz, concatenated .gz) are handled.
+class GzipChunkReader : public HalfHitChunkSource {
+public:
+    explicit GzipChunkReader(const std::string& filename,
+                             std::size_t chunkBytes = 4 * 1024 * 1024);
+    ~GzipChunkReader() override;
+    bool next(std::vector<HalfHit>& out) override;
+
+private:
+    void decompressLoop();
+    void setError(const std::string& message);
+
+    std::string filename_;
+    std::size_t chunkBytes_;
+    BoundedQueue<std::string> queue_{4};
+    std::thread decompressor_;
+    std::string carry_;
+    bool headerSkipped_ = false;
+    bool done_ = false;
+    std::mutex errorMutex_;
+    std::string error_;
+};
+
+// Opens the right chunk source for the file by its magic bytes: gzip
+// input decompresses on the fly, anything else parses as plain CSV.
+// zstd input is recognized but rejected with a clear error, since this
+// build links only zlib.
+std::unique_ptr<HalfHitChunkSource> openHalfHitChunkSource(
+    const std::string& filename);
+
+// Path the matched-hit outputs are derived from: the input with its
+// extension stripped (and any trailing ".gz" first, so compressed runs
+// land next to their source with the same stem).
+std::string matchedOutputBase(const std::string& filename);
+
 class CSVWriter {
 public:
     static void writeMatchedHits(
@@ -15,3 +175,33 @@ public:
         const std::vector<MatchedHit>& hits
     );
 };
+
+// Incremental matched-hit writer: accepts batches in output order and
+// keeps the running row index across them, so a sequence of write()
+// calls produces the same file as one CSVWriter::writeMatchedHits call.
+// Used by the asynchronous write stage in main.cpp to stream each
+// (layer, chip) batch out while later buckets are still matching.
+class CSVBatchWriter {
+public:
+    explicit CSVBatchWriter(const std::string& filename);
+    // Append mode for incremental runs: reopens an existing output and
+    // continues the row index at startIndex instead of writing a header.
+    CSVBatchWriter(const std::string& filename, std::size_t startIndex);
+    ~CSVBatchWriter();
+    CSVBatchWriter(const CSVBatchWriter&) = delete;
+    CSVBatchWriter& operator=(const CSVBatchWriter&) = delete;
+
+    void write(const std::vector<MatchedHit>& hits);
+    // Flushes and closes the file; throws on write failure. Called by
+    // the destructor if not invoked explicitly.
+    void close();
+
+private:
+    void flushBlock();
+
+    std::string filename_;
+    std::FILE* file_ = nullptr;
+    std::vector<char> block_;
+    char* cursor_ = nullptr;
+    std::size_t nextIndex_ = 0;
+};
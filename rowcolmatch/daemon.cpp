@@ -0,0 +1,216 @@
+#include "daemon.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "csv_io.h"
+#include "filter.h"
+#include "stream.h"
+
+namespace {
+
+// apx_udpsend.py sends one readout per datagram, so a single
+// MTU-independent receive buffer of the UDP maximum is enough; it is
+// allocated once and reused for every packet.
+constexpr std::size_t kMaxPacket = 65535;
+// Keep outbound datagrams safely under the UDP payload ceiling.
+constexpr std::size_t kMaxPayload = 60000;
+
+volatile std::sig_atomic_t gStop = 0;
+
+void handleSignal(int) {
+    gStop = 1;
+}
+
+bool isMulticastGroup(const std::string& group) {
+    in_addr addr{};
+    if (inet_aton(group.c_str(), &addr) == 0) {
+        return false;
+    }
+    unsigned firstOctet = ntohl(addr.s_addr) >> 24;
+    return firstOctet >= 224 && firstOctet <= 239;
+}
+
+sockaddr_in makeAddress(const std::string& group, int port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (inet_aton(group.c_str(), &addr.sin_addr) == 0) {
+        throw std::runtime_error("Invalid address: " + group);
+    }
+    return addr;
+}
+
+// Mirrors MulticastReceiver in astropix_analysis/sock.py: a multicast
+// group binds to all interfaces and joins the group, anything else is
+// bound directly. The receive timeout keeps the loop responsive to the
+// shutdown signal without busy-waiting.
+int openIngestSocket(const std::string& group, int port) {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create ingest socket");
+    }
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    timeval timeout{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_in addr = makeAddress(group, port);
+    bool multicast = isMulticastGroup(group);
+    if (multicast) {
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot bind " + group + ":" +
+                                 std::to_string(port));
+    }
+    if (multicast) {
+        ip_mreq mreq{};
+        inet_aton(group.c_str(), &mreq.imr_multiaddr);
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                         &mreq, sizeof(mreq)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot join group " + group);
+        }
+    }
+    return fd;
+}
+
+int openPublishSocket(const std::string& group) {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create publish socket");
+    }
+    if (isMulticastGroup(group)) {
+        unsigned char ttl = 2;
+        ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    }
+    return fd;
+}
+
+// One _matched.csv-style row per match. The running index makes the
+// outbound stream self-describing about drops: a gap in the index
+// column means the consumer lost a datagram.
+void appendMatch(std::string& out, std::size_t index, const MatchedHit& h) {
+    char row[320];
+    int n = std::snprintf(
+        row, sizeof(row), "%zu,%d,%d,%d,%d,%d,%d,%d,%d,%g,%g,%lld,%lld\n",
+        index, h.layer, h.chipID, h.row, h.col,
+        h.row_timestamp, h.col_timestamp, h.row_tot, h.col_tot,
+        h.row_tot_us, h.col_tot_us, h.row_fpga_ts, h.col_fpga_ts);
+    out.append(row, n);
+}
+
+void publish(int fd, const sockaddr_in& dest,
+             const std::vector<MatchedHit>& matches, std::size_t& index) {
+    std::string payload;
+    for (const auto& h : matches) {
+        appendMatch(payload, index++, h);
+        if (payload.size() >= kMaxPayload) {
+            ::sendto(fd, payload.data(), payload.size(), 0,
+                     reinterpret_cast<const sockaddr*>(&dest), sizeof(dest));
+            payload.clear();
+        }
+    }
+    if (!payload.empty()) {
+        ::sendto(fd, payload.data(), payload.size(), 0,
+                 reinterpret_cast<const sockaddr*>(&dest), sizeof(dest));
+    }
+}
+
+} // namespace
+
+int runDaemon(const DaemonOptions& opt) {
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    int ingest = openIngestSocket(opt.listenGroup, opt.listenPort);
+    int publisher = openPublishSocket(opt.sendGroup);
+    sockaddr_in dest = makeAddress(opt.sendGroup, opt.sendPort);
+    if (!opt.quiet) {
+        std::cout << "Listening on " << opt.listenGroup << ":"
+                  << opt.listenPort << ", publishing matches to "
+                  << opt.sendGroup << ":" << opt.sendPort << "\n";
+    }
+
+    std::size_t nBuckets = static_cast<std::size_t>(opt.layers) * opt.chips;
+    std::vector<StreamChipMatcher> matchers(
+        nBuckets, StreamChipMatcher(opt.fts, opt.ftot));
+    std::vector<unsigned char> packet(kMaxPacket);
+    std::vector<HalfHit> hits;
+    std::vector<MatchedHit> matches;
+    std::string carry;
+    ValidHalfHit valid;
+
+    std::size_t nDatagrams = 0, nDropped = 0;
+    std::size_t nRead = 0, nValid = 0, nMatches = 0;
+
+    while (!gStop) {
+        ssize_t n = ::recvfrom(ingest, packet.data(), packet.size(), 0,
+                               nullptr, nullptr);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue;
+            }
+            std::cerr << "recvfrom: " << std::strerror(errno) << "\n";
+            break;
+        }
+        ++nDatagrams;
+        hits.clear();
+        if (!ApxReader::decodeDatagram(packet.data(),
+                                       static_cast<std::size_t>(n),
+                                       carry, hits)) {
+            ++nDropped;
+            continue;
+        }
+        nRead += hits.size();
+
+        matches.clear();
+        for (const auto& h : hits) {
+            if (!valid(h)) {
+                continue;
+            }
+            ++nValid;
+            if (h.layer < 0 || h.layer >= opt.layers ||
+                h.chipID < 0 || h.chipID >= opt.chips) {
+                continue;
+            }
+            std::size_t b = h.layer * opt.chips + h.chipID;
+            matchers[b].add(h, matches);
+        }
+        if (!matches.empty()) {
+            publish(publisher, dest, matches, nMatches);
+        }
+    }
+
+    // Close the final column bursts so a clean shutdown publishes the
+    // tail matches instead of dropping them.
+    matches.clear();
+    for (auto& m : matchers) {
+        m.flush(matches);
+    }
+    if (!matches.empty()) {
+        publish(publisher, dest, matches, nMatches);
+    }
+    ::close(ingest);
+    ::close(publisher);
+
+    if (!opt.quiet) {
+        std::cout << nDatagrams << " datagrams received ("
+                  << nDropped << " malformed), "
+                  << nRead << " halfhits decoded, "
+                  << nValid << " valid, "
+                  << nMatches << " hits matched\n";
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include "rowcolmatch.h"
+
+// Live UDP ingest daemon (--daemon).
+//
+// apx_udpsend.py multicasts one readout record per datagram (the same
+// record layout as the .apx container); the file-based path can only
+// see those hits after a capture is closed and converted, which puts
+// minutes between trigger and display. The daemon binds the ingest
+// socket, decodes each datagram straight out of a preallocated packet
+// buffer, feeds the hits through the incremental per-chip matchers and
+// republishes the new matches on an outbound socket immediately, so
+// hit-to-display latency is one datagram round trip.
+//
+// Matched hits go out as CSV text, one _matched.csv-style row per
+// line, one datagram per ingested readout; any of the python-side
+// consumers can parse that with the stock csv module.
+
+struct DaemonOptions {
+    // Ingest address; a multicast group is joined, anything else is
+    // bound directly (mirrors astropix_analysis/sock.py).
+    std::string listenGroup = "127.0.0.1";
+    int listenPort = 5007;
+    // Publish address for the matched-hit stream.
+    std::string sendGroup = "127.0.0.1";
+    int sendPort = 5008;
+    int layers = 3;
+    int chips = 4;
+    WindowPredicate fts{0, 1};
+    WindowPredicate ftot{6, 15};
+    bool quiet = false;
+};
+
+// Runs until SIGINT/SIGTERM; returns the process exit code.
+int runDaemon(const DaemonOptions& opt);
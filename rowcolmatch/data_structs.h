@@ -1,7 +1,9 @@
 #pragma once
+#include <cstddef>
 #include <sstream>
 #include <string>
 #include <cstring>
+#include <vector>
 
 struct HalfHit {
     int layer;
@@ -34,3 +36,99 @@ struct MatchedHit {
     long long row_fpga_ts;
     long long col_fpga_ts;
 };
+
+inline MatchedHit makeMatchedHit(const HalfHit& rowHit, const HalfHit& colHit) {
+    return {
+        rowHit.layer,
+        rowHit.chipID,
+        rowHit.location,
+        colHit.location,
+        rowHit.timestamp,
+        colHit.timestamp,
+        rowHit.tot_total,
+        colHit.tot_total,
+        rowHit.tot_us,
+        colHit.tot_us,
+        rowHit.fpga_ts,
+        colHit.fpga_ts
+    };
+}
+
+// Bit-packed half-hit for memory-limited runs: the physical field
+// ranges are tiny (layer and chipID are 3 bits, location < 35 fits in
+// 6, the chip timestamp is 8, tot_total 16), so everything except the
+// FPGA timestamp packs into one 64-bit word and the record shrinks
+// from 48 to 16 bytes. tot_us is not stored: it is a derived quantity
+// (tot_total times the sampling clock period) and is recomputed from a
+// per-run scale when a match is emitted.
+struct PackedHalfHit {
+    long long fpga_ts;
+    unsigned layer : 3;
+    unsigned chipID : 3;
+    unsigned payload : 3;
+    unsigned location : 6;
+    unsigned isCol : 1;
+    unsigned timestamp : 8;
+    unsigned tot_total : 16;
+};
+
+static_assert(sizeof(PackedHalfHit) == 16,
+              "PackedHalfHit expected to pack into 16 bytes");
+
+inline PackedHalfHit packHalfHit(const HalfHit& h) {
+    PackedHalfHit p;
+    p.fpga_ts = h.fpga_ts;
+    p.layer = h.layer;
+    p.chipID = h.chipID;
+    p.payload = h.payload;
+    p.location = h.location;
+    p.isCol = h.isCol;
+    p.timestamp = h.timestamp;
+    p.tot_total = h.tot_total;
+    return p;
+}
+
+inline MatchedHit makeMatchedHit(const PackedHalfHit& rowHit,
+                                 const PackedHalfHit& colHit,
+                                 double totUsScale) {
+    return {
+        static_cast<int>(rowHit.layer),
+        static_cast<int>(rowHit.chipID),
+        static_cast<int>(rowHit.location),
+        static_cast<int>(colHit.location),
+        static_cast<int>(rowHit.timestamp),
+        static_cast<int>(colHit.timestamp),
+        static_cast<int>(rowHit.tot_total),
+        static_cast<int>(colHit.tot_total),
+        rowHit.tot_total * totUsScale,
+        colHit.tot_total * totUsScale,
+        rowHit.fpga_ts,
+        colHit.fpga_ts
+    };
+}
+
+// Structure-of-arrays view of a hit span for the match inner loop: the
+// scan only touches isCol, timestamp and tot_total, so streaming those
+// as dense arrays avoids dragging the 40 unused HalfHit bytes through
+// cache per candidate comparison. The index array recovers the full
+// AoS record once a match fires.
+struct HitSoA {
+    std::vector<unsigned char> isCol;
+    std::vector<int> timestamp;
+    std::vector<int> tot_total;
+    std::vector<unsigned> index;
+
+    template <typename Hit>
+    void build(const Hit* hits, std::size_t n) {
+        isCol.resize(n);
+        timestamp.resize(n);
+        tot_total.resize(n);
+        index.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            isCol[i] = static_cast<unsigned char>(hits[i].isCol);
+            timestamp[i] = hits[i].timestamp;
+            tot_total[i] = hits[i].tot_total;
+            index[i] = static_cast<unsigned>(i);
+        }
+    }
+};
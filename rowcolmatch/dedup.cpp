@@ -0,0 +1,105 @@
+#include "dedup.h"
+#include <algorithm>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+// Grouping order: all matches of one pixel adjacent and time-ascending,
+// so the collapse below is a single linear pass. The trailing fields
+// only break ties, keeping the kept representative deterministic
+// regardless of the incoming order or thread count.
+auto groupKey(const MatchedHit& h) {
+    return std::tie(h.layer, h.chipID, h.row, h.col, h.row_fpga_ts,
+                    h.row_timestamp, h.col_timestamp, h.row_tot, h.col_tot,
+                    h.col_fpga_ts);
+}
+
+// Output order: the (layer, chipID, fpga_ts, row, col) key the
+// downstream analysis sorts by anyway.
+auto outputKey(const MatchedHit& h) {
+    return std::tie(h.layer, h.chipID, h.row_fpga_ts, h.row, h.col,
+                    h.row_timestamp, h.col_timestamp, h.row_tot, h.col_tot,
+                    h.col_fpga_ts);
+}
+
+// Sorts nWorkers contiguous chunks concurrently, then merges them in
+// parallel pairwise rounds; identical result to a single std::sort.
+template <typename Less>
+void parallelSort(std::vector<MatchedHit>& v, int threads, Less less) {
+    std::size_t n = v.size();
+    std::size_t nWorkers = threads > 1 ? static_cast<std::size_t>(threads) : 1;
+    if (nWorkers <= 1 || n < (1u << 16)) {
+        std::sort(v.begin(), v.end(), less);
+        return;
+    }
+
+    std::vector<std::size_t> bounds(nWorkers + 1);
+    for (std::size_t i = 0; i <= nWorkers; ++i) {
+        bounds[i] = n * i / nWorkers;
+    }
+    {
+        std::vector<std::thread> sorters;
+        sorters.reserve(nWorkers);
+        for (std::size_t i = 0; i < nWorkers; ++i) {
+            sorters.emplace_back([&v, &bounds, i, less]() {
+                std::sort(v.begin() + bounds[i], v.begin() + bounds[i + 1],
+                          less);
+            });
+        }
+        for (auto& t : sorters) {
+            t.join();
+        }
+    }
+    for (std::size_t width = 1; width < nWorkers; width *= 2) {
+        std::vector<std::thread> mergers;
+        for (std::size_t i = 0; i + width < nWorkers; i += 2 * width) {
+            auto first = v.begin() + bounds[i];
+            auto mid = v.begin() + bounds[i + width];
+            auto last = v.begin() + bounds[std::min(i + 2 * width, nWorkers)];
+            mergers.emplace_back([first, mid, last, less]() {
+                std::inplace_merge(first, mid, last, less);
+            });
+        }
+        for (auto& t : mergers) {
+            t.join();
+        }
+    }
+}
+
+} // namespace
+
+std::size_t dedupMatches(std::vector<MatchedHit>& matches,
+                         long long tolerance, int threads) {
+    if (matches.empty()) {
+        return 0;
+    }
+    parallelSort(matches, threads, [](const MatchedHit& a,
+                                      const MatchedHit& b) {
+        return groupKey(a) < groupKey(b);
+    });
+
+    // Keep the first match of each pixel; later matches of the same
+    // pixel are duplicates while they stay within `tolerance` ticks of
+    // the last one kept, so a fresh hit after a quiet gap survives.
+    std::size_t kept = 1;
+    for (std::size_t i = 1; i < matches.size(); ++i) {
+        const MatchedHit& prev = matches[kept - 1];
+        const MatchedHit& cur = matches[i];
+        bool duplicate = cur.layer == prev.layer &&
+                         cur.chipID == prev.chipID &&
+                         cur.row == prev.row && cur.col == prev.col &&
+                         cur.row_fpga_ts - prev.row_fpga_ts <= tolerance;
+        if (!duplicate) {
+            matches[kept++] = cur;
+        }
+    }
+    std::size_t removed = matches.size() - kept;
+    matches.resize(kept);
+
+    parallelSort(matches, threads, [](const MatchedHit& a,
+                                      const MatchedHit& b) {
+        return outputKey(a) < outputKey(b);
+    });
+    return removed;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "data_structs.h"
+
+// Post-match duplicate suppression (--dedup).
+//
+// The matcher emits one MatchedHit per satisfying (row, col) pair, so a
+// noisy burst turns one physical hit into several near-duplicate
+// matches on the same pixel. This stage sorts the full match set in
+// parallel, collapses matches of the same (layer, chipID, row, col)
+// whose FPGA timestamps fall within `tolerance` ticks of the last kept
+// match, and re-sorts the survivors into (layer, chipID, fpga_ts, row,
+// col) order for the output file. A multi-threaded sort over tens of
+// millions of records takes seconds, against the minutes the pandas
+// cleanup used to spend.
+//
+// Returns the number of duplicates removed; `matches` is left holding
+// the deduplicated, output-ordered survivors.
+std::size_t dedupMatches(std::vector<MatchedHit>& matches,
+                         long long tolerance, int threads);
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "data_structs.h"
+
+// Bulk corruption-rejection stage. The survivor compaction is written
+// branch-free (unconditional store, cursor advanced by the predicate
+// value) over a pre-sized output, so the compiler can vectorize the
+// predicate evaluation and the pass never reallocates, unlike the old
+// per-hit push_back loop.
+
+// Default validity cut: intact payload marker and a location inside
+// the 35-pixel geometry. Detector-specific cuts (dead-pixel masks,
+// timestamp sanity windows, ...) slot in as further predicate types
+// without touching the compaction loop.
+struct ValidHalfHit {
+    template <typename Hit>
+    bool operator()(const Hit& h) const {
+        return h.payload == 4 && h.location < 35;
+    }
+};
+
+template <typename Hit, typename Pred>
+std::vector<Hit> filterHits(const Hit* in, std::size_t nIn, Pred pred) {
+    std::vector<Hit> out(nIn);
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < nIn; ++i) {
+        out[n] = in[i];
+        n += static_cast<std::size_t>(pred(in[i]));
+    }
+    out.resize(n);
+    return out;
+}
+
+template <typename Hit, typename Pred>
+std::vector<Hit> filterHits(const std::vector<Hit>& in, Pred pred) {
+    return filterHits(in.data(), in.size(), pred);
+}
+
+template <typename Hit>
+std::vector<Hit> filterHits(const std::vector<Hit>& in) {
+    return filterHits(in, ValidHalfHit{});
+}
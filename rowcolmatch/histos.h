@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "data_structs.h"
+
+// In-engine monitoring histograms, enabled by --histos.
+//
+// The shift monitor only needs per-chip hitmaps and ToT/timestamp
+// spectra, which used to mean writing the full _matched.csv and
+// re-parsing it in astropix_analysis/hist.py. Filling fixed-bin
+// accumulators as the matches stream past is O(matches) with tiny
+// constants, and the dump is kilobytes of JSON instead of gigabytes of
+// CSV.
+class MatchHistos {
+public:
+    // 35x35 occupancy grid, matching the location < 35 geometry cut.
+    static constexpr int kPixels = 35;
+    // ToT spectrum: 256 bins of 16 clock cycles, covering the 12-bit
+    // counter range; overflow goes into the last bin.
+    static constexpr int kTotBins = 256;
+    static constexpr int kTotBinWidth = 16;
+    // Timestamp spectrum: one bin per 8-bit chip timestamp value.
+    static constexpr int kTsBins = 256;
+
+    MatchHistos(int layers, int chips)
+        : layers_(layers), chips_(chips),
+          occupancy_(static_cast<std::size_t>(layers) * chips * kPixels * kPixels, 0),
+          tot_(static_cast<std::size_t>(layers) * chips * kTotBins, 0),
+          timestamp_(static_cast<std::size_t>(layers) * chips * kTsBins, 0),
+          entries_(static_cast<std::size_t>(layers) * chips, 0) {}
+
+    void fill(const MatchedHit& h) {
+        if (h.layer < 0 || h.layer >= layers_ ||
+            h.chipID < 0 || h.chipID >= chips_) {
+            return;
+        }
+        std::size_t b = h.layer * chips_ + h.chipID;
+        ++entries_[b];
+        if (h.row >= 0 && h.row < kPixels && h.col >= 0 && h.col < kPixels) {
+            ++occupancy_[(b * kPixels + h.row) * kPixels + h.col];
+        }
+        fillTot(b, h.row_tot);
+        fillTot(b, h.col_tot);
+        fillTimestamp(b, h.row_timestamp);
+        fillTimestamp(b, h.col_timestamp);
+    }
+
+    void fill(const std::vector<MatchedHit>& hits) {
+        for (const auto& h : hits) {
+            fill(h);
+        }
+    }
+
+    void writeJson(const std::string& path) const {
+        std::ofstream os(path);
+        if (!os.is_open()) {
+            throw std::runtime_error("Cannot open output file: " + path);
+        }
+        os << "{\n"
+           << "  \"pixels\": " << kPixels << ",\n"
+           << "  \"tot_bins\": " << kTotBins << ",\n"
+           << "  \"tot_bin_width\": " << kTotBinWidth << ",\n"
+           << "  \"timestamp_bins\": " << kTsBins << ",\n"
+           << "  \"chips\": [";
+        bool first = true;
+        for (int layer = 0; layer < layers_; ++layer) {
+            for (int chip = 0; chip < chips_; ++chip) {
+                std::size_t b = layer * chips_ + chip;
+                os << (first ? "" : ",") << "\n    {\"layer\": " << layer
+                   << ", \"chip\": " << chip
+                   << ", \"entries\": " << entries_[b]
+                   << ",\n     \"occupancy\": ";
+                writeOccupancy(os, b);
+                os << ",\n     \"tot\": ";
+                writeBins(os, tot_.data() + b * kTotBins, kTotBins);
+                os << ",\n     \"timestamp\": ";
+                writeBins(os, timestamp_.data() + b * kTsBins, kTsBins);
+                os << "}";
+                first = false;
+            }
+        }
+        os << "\n  ]\n}\n";
+    }
+
+private:
+    void fillTot(std::size_t b, int tot) {
+        if (tot < 0) {
+            return;
+        }
+        int bin = tot / kTotBinWidth;
+        if (bin >= kTotBins) {
+            bin = kTotBins - 1;
+        }
+        ++tot_[b * kTotBins + bin];
+    }
+
+    void fillTimestamp(std::size_t b, int ts) {
+        if (ts >= 0 && ts < kTsBins) {
+            ++timestamp_[b * kTsBins + ts];
+        }
+    }
+
+    void writeOccupancy(std::ofstream& os, std::size_t b) const {
+        os << "[";
+        for (int row = 0; row < kPixels; ++row) {
+            os << (row ? ", [" : "[");
+            const std::uint64_t* line =
+                occupancy_.data() + (b * kPixels + row) * kPixels;
+            for (int col = 0; col < kPixels; ++col) {
+                os << (col ? ", " : "") << line[col];
+            }
+            os << "]";
+        }
+        os << "]";
+    }
+
+    static void writeBins(std::ofstream& os, const std::uint64_t* bins,
+                          int nBins) {
+        os << "[";
+        for (int i = 0; i < nBins; ++i) {
+            os << (i ? ", " : "") << bins[i];
+        }
+        os << "]";
+    }
+
+    int layers_;
+    int chips_;
+    std::vector<std::uint64_t> occupancy_;
+    std::vector<std::uint64_t> tot_;
+    std::vector<std::uint64_t> timestamp_;
+    std::vector<std::uint64_t> entries_;
+};
@@ -0,0 +1,146 @@
+#include "hitcache.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "csv_io.h"
+
+namespace {
+
+// On-disk sidecar: 'RCMH' magic, version, the (layers, chips) geometry
+// the partitioning was built for, the source file key, the summary
+// totals, then the span offsets and the raw partitioned HalfHit array.
+// HalfHit is trivially copyable, so the payload round-trips as bytes.
+constexpr char kMagic[4] = {'R', 'C', 'M', 'H'};
+constexpr std::uint32_t kVersion = 1;
+
+struct CacheHeader {
+    std::uint32_t version;
+    std::int32_t layers;
+    std::int32_t chips;
+    std::uint64_t srcSize;
+    std::int64_t srcMtime;
+    std::uint64_t nRead;
+    std::uint64_t nValid;
+    std::uint64_t nHits;
+};
+
+std::string cachePath(const std::string& filename) {
+    return matchedOutputBase(filename) + "_halfhits.cache";
+}
+
+// Size/mtime key of the source file; false for non-regular files.
+bool sourceKey(const std::string& filename, std::uint64_t& size,
+               std::int64_t& mtime) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    size = static_cast<std::uint64_t>(st.st_size);
+    mtime = static_cast<std::int64_t>(st.st_mtime);
+    return true;
+}
+
+void writeRaw(std::FILE* f, const void* data, std::size_t size,
+              const std::string& path) {
+    if (std::fwrite(data, 1, size, f) != size) {
+        throw std::runtime_error("Short write on cache: " + path);
+    }
+}
+
+} // namespace
+
+bool loadHitCache(const std::string& filename, int layers, int chips,
+                  ChipPartitions& parts, HitCacheMeta& meta) {
+    std::uint64_t srcSize;
+    std::int64_t srcMtime;
+    if (!sourceKey(filename, srcSize, srcMtime)) {
+        return false;
+    }
+    std::string path = cachePath(filename);
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+
+    // A sidecar that fails any check below is stale or foreign, not an
+    // error: fall back to parsing, after which it gets rewritten.
+    char magic[4];
+    CacheHeader header;
+    std::vector<std::uint64_t> offsets;
+    bool ok = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+              std::memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+              std::fread(&header, 1, sizeof(header), f) == sizeof(header) &&
+              header.version == kVersion &&
+              header.layers == layers &&
+              header.chips == chips &&
+              header.srcSize == srcSize &&
+              header.srcMtime == srcMtime;
+    if (ok) {
+        std::size_t nBuckets = static_cast<std::size_t>(layers) * chips;
+        offsets.resize(nBuckets + 1);
+        ok = std::fread(offsets.data(), sizeof(std::uint64_t),
+                        offsets.size(), f) == offsets.size() &&
+             offsets.back() == header.nHits;
+    }
+    if (ok) {
+        parts.layers = layers;
+        parts.chips = chips;
+        parts.offsets.assign(offsets.begin(), offsets.end());
+        parts.hits.resize(header.nHits);
+        ok = std::fread(parts.hits.data(), sizeof(HalfHit),
+                        parts.hits.size(), f) == parts.hits.size();
+    }
+    std::fclose(f);
+    if (!ok) {
+        parts = ChipPartitions{};
+        return false;
+    }
+    meta.nRead = header.nRead;
+    meta.nValid = header.nValid;
+    return true;
+}
+
+void saveHitCache(const std::string& filename, int layers, int chips,
+                  const ChipPartitions& parts, const HitCacheMeta& meta) {
+    std::uint64_t srcSize;
+    std::int64_t srcMtime;
+    if (!sourceKey(filename, srcSize, srcMtime)) {
+        return;
+    }
+    std::string path = cachePath(filename);
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        throw std::runtime_error("Cannot open cache: " + tmp);
+    }
+
+    CacheHeader header{};
+    header.version = kVersion;
+    header.layers = layers;
+    header.chips = chips;
+    header.srcSize = srcSize;
+    header.srcMtime = srcMtime;
+    header.nRead = meta.nRead;
+    header.nValid = meta.nValid;
+    header.nHits = parts.hits.size();
+    std::vector<std::uint64_t> offsets(parts.offsets.begin(),
+                                       parts.offsets.end());
+    try {
+        writeRaw(f, kMagic, sizeof(kMagic), tmp);
+        writeRaw(f, &header, sizeof(header), tmp);
+        writeRaw(f, offsets.data(),
+                 offsets.size() * sizeof(std::uint64_t), tmp);
+        writeRaw(f, parts.hits.data(),
+                 parts.hits.size() * sizeof(HalfHit), tmp);
+    } catch (...) {
+        std::fclose(f);
+        throw;
+    }
+    // Written to a temp file and renamed into place, so a crash
+    // mid-write cannot leave a truncated sidecar behind.
+    if (std::fclose(f) != 0 || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot finalize cache: " + path);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "partition.h"
+
+// Persistent binary sidecar of the parsed, filtered and partitioned
+// halfhits (--cache).
+//
+// Cut tuning reruns the same input dozens of times while only the
+// match windows change, and parsing dominates every iteration. With
+// --cache the first run writes the ready-to-match ChipPartitions next
+// to the output, keyed by the source file's size and mtime; later runs
+// with the same geometry load it in one sequential read and jump
+// straight to matching. A stale or mismatched sidecar is ignored and
+// rewritten.
+
+struct HitCacheMeta {
+    // Read/valid totals of the original parse, for the run summary.
+    std::size_t nRead = 0;
+    std::size_t nValid = 0;
+};
+
+// Loads the sidecar for `filename` if it exists and still matches the
+// source file and the (layers, chips) geometry; returns false (leaving
+// parts untouched) otherwise.
+bool loadHitCache(const std::string& filename, int layers, int chips,
+                  ChipPartitions& parts, HitCacheMeta& meta);
+
+// Writes the sidecar next to the output; quietly does nothing when the
+// source is not a regular file (pipes have no stable size/mtime key).
+void saveHitCache(const std::string& filename, int layers, int chips,
+                  const ChipPartitions& parts, const HitCacheMeta& meta);
@@ -1,18 +1,65 @@
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "data_structs.h"
 #include "rowcolmatch.h"
+#include "filter.h"
+#include "partition.h"
+#include "batch.h"
+#include "bounded_queue.h"
+#include "stream.h"
+#include "stats.h"
 #include "csv_io.h"
+#include "checkpoint.h"
+#include "coincidence.h"
+#include "daemon.h"
+#include "dedup.h"
+#include "histos.h"
+#include "hitcache.h"
+#include "shard.h"
+#include "binary_io.h"
 
 static void usage() {
     std::cout <<
-    "Usage: rowcolmatch <file.csv> [options]\n\n"
+    "Usage: rowcolmatch <file.csv> [file2.csv ...] [options]\n\n"
     "Options:\n"
     "  -q, --quiet           Suppress output\n"
     "  -l, --layers <int>    Number of layers (default: 3)\n"
+    "  -t, --threads <int>   Parser worker threads (default: 1)\n"
+    "  --stream              Bounded-memory pipeline for files larger than RAM\n"
+    "  --packed              Use the 16-byte packed in-memory hit record\n"
+    "  --stats               Print per-phase timing (and counters in STATS=1 builds)\n"
+    "  --stats-json <file>   Also dump the stats as JSON\n"
+    "  --format <fmt>        Output format: csv (default) or binary (columnar)\n"
+    "  --engine <name>       Match engine: scan (default) or window\n"
+    "  --manifest <file>     Also process the files listed one per line in <file>\n"
+    "  --incremental         Resume from the checkpoint and append new matches\n"
+    "  --finalize            With --incremental: flush tails, drop the checkpoint\n"
+    "  --coinc               Also build cross-layer coincidence groups\n"
+    "  --coinc-window <int>  Coincidence window in FPGA ticks (default: 2)\n"
+    "  --coinc-layers <int>  Min distinct layers per group (default: 2)\n"
+    "  --histos              Also dump per-chip occupancy and spectra as JSON\n"
+    "  --tolerant            Quarantine malformed CSV rows instead of aborting\n"
+    "  --dedup               Collapse near-duplicate matches before writing\n"
+    "  --dedup-window <int>  Dedup tolerance in FPGA ticks (default: 0)\n"
+    "  --cache               Keep a binary sidecar of the parsed halfhits\n"
+    "  --scan <file>         Count matches for every cut window listed in <file>\n"
+    "                        (one 'mints maxts mintot maxtot' tuple per line)\n"
+    "  --scan-write          With --scan: also write per-window matched files\n"
+    "  --shard <i/N>         Match byte range i of N only; write a per-shard\n"
+    "                        matched file for --merge\n"
+    "  --merge <N>           Merge N shard outputs into the final matched CSV\n"
+    "  --daemon              Ingest readouts over UDP and republish matches\n"
+    "  --udp-in <host:port>  Daemon ingest address (default: 127.0.0.1:5007)\n"
+    "  --udp-out <host:port> Daemon publish address (default: 127.0.0.1:5008)\n"
     "  -c, --chips <int>     Number of chips per layer (default: 4)\n"
     "  --mints <int>         Min TS difference (default: 0)\n"
     "  --maxts <int>         Max TS difference (default: 1)\n"
@@ -20,15 +67,127 @@ static void usage() {
     "  --maxtot <int>        Max ToT difference (default: 15)\n";
 }
 
+// Runs fn(bucket) for every bucket index, on a worker pool when more
+// than one thread is requested. Buckets are independent, so workers
+// just pull indices off an atomic counter.
+template <typename Fn>
+static void forEachBucket(std::size_t nBuckets, int threads, Fn fn) {
+    unsigned nWorkers = std::min<std::size_t>(
+        threads > 0 ? threads : 1, nBuckets);
+    if (nWorkers > 1) {
+        std::atomic<std::size_t> nextBucket{0};
+        std::vector<std::thread> pool;
+        pool.reserve(nWorkers);
+        for (unsigned w = 0; w < nWorkers; ++w) {
+            pool.emplace_back([&]() {
+                for (std::size_t b = nextBucket++; b < nBuckets;
+                     b = nextBucket++) {
+                    fn(b);
+                }
+            });
+        }
+        for (auto& t : pool) {
+            t.join();
+        }
+    } else {
+        for (std::size_t b = 0; b < nBuckets; ++b) {
+            fn(b);
+        }
+    }
+}
+
+static void printChipSummary(int layer, int chip, std::size_t nchip,
+                             std::size_t nMatches) {
+    double pct = nchip == 0 ? 0.0 : 100.0 * nMatches * 2.0 / nchip;
+    std::cout << "Layer " << layer
+              << ", Chip " << chip
+              << ": " << nchip
+              << " halfhits found, "
+              << nMatches
+              << " hits matched ("
+              << std::fixed << std::setprecision(2) << pct << "%)\n";
+}
+
+static bool parseEndpoint(const std::string& endpoint, std::string& group,
+                          int& port) {
+    std::size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos || colon == 0 ||
+        colon + 1 == endpoint.size()) {
+        return false;
+    }
+    group = endpoint.substr(0, colon);
+    try {
+        port = std::stoi(endpoint.substr(colon + 1));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return port > 0 && port < 65536;
+}
+
+static bool parseShardSpec(const std::string& spec, int& index, int& count) {
+    std::size_t slash = spec.find('/');
+    if (slash == std::string::npos || slash == 0 ||
+        slash + 1 == spec.size()) {
+        return false;
+    }
+    try {
+        index = std::stoi(spec.substr(0, slash));
+        count = std::stoi(spec.substr(slash + 1));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return count >= 1 && index >= 0 && index < count;
+}
+
+static void printDedupSummary(std::size_t removed, std::size_t kept) {
+    std::cout << removed << " duplicate matches collapsed, "
+              << kept << " kept\n";
+}
+
+static void printReadSummary(std::size_t nRead, std::size_t nValid) {
+    double pct = nRead == 0 ? 0.0 : 100.0 * nValid / nRead;
+    std::cout << nRead << " decoded halfhits read, "
+              << nValid << " valid ("
+              << std::fixed << std::setprecision(2) << pct << "%)\n";
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cerr << "Usage: rowcolmatch <file.csv>\n";
         return 1;
     }
 
+    std::vector<std::string> files;
     std::string filename;
     bool quiet = false;
+    bool stream = false;
+    bool packed = false;
+    bool stats = false;
+    std::string statsJson;
+    std::string format = "csv";
+    std::string engine = "scan";
+    bool incremental = false;
+    bool finalize = false;
+    bool coinc = false;
+    long long coincWindow = 2;
+    int coincLayers = 2;
+    bool histos = false;
+    bool tolerant = false;
+    bool dedup = false;
+    long long dedupWindow = 0;
+    bool cache = false;
+    std::vector<ScanWindow> scanWindows;
+    bool scan = false;
+    bool scanWrite = false;
+    bool shard = false;
+    int shardIndex = 0;
+    int shardCount = 1;
+    int mergeCount = 0;
+    bool daemon = false;
+    std::string udpIn = "127.0.0.1:5007";
+    std::string udpOut = "127.0.0.1:5008";
     int layers = 3, chips = 4;
+    int threads = 1;
     int mints = 0, maxts = 1;
     int mintot = 6, maxtot = 15;
 
@@ -37,81 +196,645 @@ int main(int argc, char* argv[]) {
         std::string arg = argv[i];
 
         if (arg == "-q" || arg == "--quiet") quiet = true;
+        else if (arg == "--stream") stream = true;
+        else if (arg == "--packed") packed = true;
+        else if (arg == "--stats") stats = true;
+        else if (arg == "--stats-json") { stats = true; statsJson = argv[++i]; }
+        else if (arg == "--format") format = argv[++i];
+        else if (arg == "--engine") engine = argv[++i];
+        else if (arg == "--incremental") incremental = true;
+        else if (arg == "--finalize") { incremental = true; finalize = true; }
+        else if (arg == "--coinc") coinc = true;
+        else if (arg == "--coinc-window") { coinc = true; coincWindow = std::stoll(argv[++i]); }
+        else if (arg == "--coinc-layers") { coinc = true; coincLayers = std::stoi(argv[++i]); }
+        else if (arg == "--histos") histos = true;
+        else if (arg == "--tolerant") tolerant = true;
+        else if (arg == "--dedup") dedup = true;
+        else if (arg == "--dedup-window") { dedup = true; dedupWindow = std::stoll(argv[++i]); }
+        else if (arg == "--cache") cache = true;
+        else if (arg == "--scan") {
+            std::ifstream windows(argv[++i]);
+            if (!windows.is_open()) {
+                std::cerr << "Cannot open scan file: " << argv[i] << "\n";
+                return 1;
+            }
+            std::string line;
+            while (std::getline(windows, line)) {
+                if (line.empty() || line[0] == '#') continue;
+                for (char& c : line) {
+                    if (c == ',') c = ' ';
+                }
+                std::istringstream ss(line);
+                ScanWindow w;
+                if (!(ss >> w.fts.min >> w.fts.max
+                         >> w.ftot.min >> w.ftot.max)) {
+                    std::cerr << "Malformed scan window: " << line << "\n";
+                    return 1;
+                }
+                scanWindows.push_back(w);
+            }
+            scan = true;
+        }
+        else if (arg == "--scan-write") { scan = true; scanWrite = true; }
+        else if (arg == "--shard") {
+            if (!parseShardSpec(argv[++i], shardIndex, shardCount)) {
+                std::cerr << "--shard wants <i/N> with 0 <= i < N\n";
+                return 1;
+            }
+            shard = true;
+        }
+        else if (arg == "--merge") { mergeCount = std::stoi(argv[++i]); }
+        else if (arg == "--daemon") daemon = true;
+        else if (arg == "--udp-in") { daemon = true; udpIn = argv[++i]; }
+        else if (arg == "--udp-out") { daemon = true; udpOut = argv[++i]; }
+        else if (arg == "--manifest") {
+            std::ifstream manifest(argv[++i]);
+            if (!manifest.is_open()) {
+                std::cerr << "Cannot open manifest: " << argv[i] << "\n";
+                return 1;
+            }
+            std::string line;
+            while (std::getline(manifest, line)) {
+                if (!line.empty() && line[0] != '#') files.push_back(line);
+            }
+        }
         else if (arg == "-l" || arg == "--layers") layers = std::stoi(argv[++i]);
+        else if (arg == "-t" || arg == "--threads") threads = std::stoi(argv[++i]);
         else if (arg == "-c" || arg == "--chips") chips = std::stoi(argv[++i]);
         else if (arg == "--mints") mints = std::stoi(argv[++i]);
         else if (arg == "--maxts") maxts = std::stoi(argv[++i]);
         else if (arg == "--mintot") mintot = std::stoi(argv[++i]);
         else if (arg == "--maxtot") maxtot = std::stoi(argv[++i]);
-        else if (arg[0] != '-') filename = arg;
+        else if (arg[0] != '-') files.push_back(arg);
         else {
             usage();
             return 1;
         }
     }
 
-    if (filename.empty()) {
+    // The daemon has no input file; everything else needs one.
+    if (daemon) {
+        if (!files.empty() || stream || packed || coinc || incremental ||
+            histos || tolerant || dedup || scan || shard || mergeCount > 0 ||
+            format != "csv") {
+            std::cerr << "--daemon takes no input file and no other mode "
+                         "flags\n";
+            return 1;
+        }
+        DaemonOptions opt;
+        if (!parseEndpoint(udpIn, opt.listenGroup, opt.listenPort) ||
+            !parseEndpoint(udpOut, opt.sendGroup, opt.sendPort)) {
+            std::cerr << "UDP addresses must be given as <host:port>\n";
+            return 1;
+        }
+        opt.layers = layers;
+        opt.chips = chips;
+        opt.fts = WindowPredicate{mints, maxts};
+        opt.ftot = WindowPredicate{mintot, maxtot};
+        opt.quiet = quiet;
+        return runDaemon(opt);
+    }
+
+    if (files.empty()) {
         usage();
         return 1;
     }
+    filename = files[0];
+    if (format != "csv" && format != "binary") {
+        std::cerr << "Unknown output format: " << format << "\n";
+        return 1;
+    }
+    if (engine != "scan" && engine != "window") {
+        std::cerr << "Unknown match engine: " << engine << "\n";
+        return 1;
+    }
 
-    auto data = CSVReader::readHalfHits(filename);
+    // Several inputs go through the shared batch scheduler; the
+    // single-file paths below keep their phase timing and streaming
+    // variants.
+    if (files.size() > 1) {
+        if (stream || packed || coinc || incremental || histos || tolerant ||
+            dedup || scan || shard || mergeCount > 0) {
+            std::cerr << "--stream/--packed/--coinc/--incremental/--histos/"
+                         "--tolerant/--dedup/--scan/--shard/--merge only "
+                         "apply to a single input file\n";
+            return 1;
+        }
+        BatchOptions opt;
+        opt.layers = layers;
+        opt.chips = chips;
+        opt.threads = threads;
+        opt.fts = WindowPredicate{mints, maxts};
+        opt.ftot = WindowPredicate{mintot, maxtot};
+        opt.engine = engine;
+        opt.format = format;
+        opt.quiet = quiet;
+        return processBatch(files, opt) == 0 ? 0 : 1;
+    }
 
-    // Filter corrupted data
-    std::vector<HalfHit> dataf;
-    for (const auto& h : data) {
-        if (h.payload == 4 && h.location < 35) {
-            dataf.push_back(h);
+    // Shard processing and the merge are self-contained: each shard
+    // writes its own output, and the merge is pure text plumbing over
+    // the shard files, so neither goes through the paths below.
+    if (mergeCount > 0) {
+        if (shard || stream || packed || coinc || incremental || histos ||
+            tolerant || dedup || scan || cache || format != "csv") {
+            std::cerr << "--merge only concatenates shard outputs\n";
+            return 1;
+        }
+        return mergeShards(filename, mergeCount, quiet);
+    }
+    if (shard) {
+        if (stream || packed || coinc || incremental || histos || tolerant ||
+            dedup || scan || cache || format != "csv") {
+            std::cerr << "--shard only applies to the plain single-file CSV "
+                         "path\n";
+            return 1;
         }
+        if (!CSVReader::isRegularFile(filename) ||
+            ApxReader::isApxFile(filename) ||
+            CSVReader::isCompressed(filename)) {
+            std::cerr << "--shard needs a plain uncompressed CSV file\n";
+            return 1;
+        }
+        ShardOptions opt;
+        opt.index = shardIndex;
+        opt.count = shardCount;
+        opt.layers = layers;
+        opt.chips = chips;
+        opt.fts = WindowPredicate{mints, maxts};
+        opt.ftot = WindowPredicate{mintot, maxtot};
+        opt.quiet = quiet;
+        return processShard(filename, opt);
     }
 
-    if (!quiet) {
-        double pct = data.empty() ? 0.0 :
-            100.0 * dataf.size() / data.size();
-        std::cout << data.size() << " decoded halfhits read, "
-                  << dataf.size() << " valid ("
-                  << std::fixed << std::setprecision(2) << pct << "%)\n";
+    // Strip the input extension and write either the CSV or the
+    // columnar binary matched-hit file next to it.
+    auto writeMatches = [&](const std::vector<MatchedHit>& hits) {
+        std::string base = matchedOutputBase(filename);
+        if (format == "binary") {
+            BinaryColumnWriter::writeMatchedHits(base + "_matched.bin", hits);
+        } else {
+            CSVWriter::writeMatchedHits(base + "_matched.csv", hits);
+        }
+    };
+
+    PhaseStats phases;
+
+    if (tolerant && (stream || packed || incremental)) {
+        std::cerr << "--tolerant only applies to the default batch path\n";
+        return 1;
     }
 
-    std::vector<MatchedHit> allMatches;
+    if (scan) {
+        if (stream || packed || incremental || coinc || histos || dedup ||
+            format != "csv") {
+            std::cerr << "--scan only applies to the default single-file "
+                         "CSV path\n";
+            return 1;
+        }
+        if (scanWindows.empty()) {
+            std::cerr << "--scan-write needs a window list (--scan <file>)\n";
+            return 1;
+        }
+    }
+
+    if (incremental) {
+        if (stream || packed || coinc || dedup || format != "csv") {
+            std::cerr << "--incremental implies the plain CSV append path\n";
+            return 1;
+        }
+        if (histos) {
+            std::cerr << "--histos cannot accumulate across --incremental "
+                         "passes\n";
+            return 1;
+        }
+        IncrementalOptions opt;
+        opt.layers = layers;
+        opt.chips = chips;
+        opt.fts = WindowPredicate{mints, maxts};
+        opt.ftot = WindowPredicate{mintot, maxtot};
+        opt.quiet = quiet;
+        opt.finalize = finalize;
+        return processIncremental(filename, opt);
+    }
 
-    for (int layer = 0; layer < layers; ++layer) {
-        for (int chip = 0; chip < chips; ++chip) {
-            std::vector<HalfHit> datac;
-            for (const auto& h : dataf) {
-                if (h.layer == layer && h.chipID == chip)
-                    datac.push_back(h);
+    if (coinc && (stream || packed)) {
+        // The coincidence merge needs the per-bucket match streams,
+        // which the bounded-memory paths discard as they go.
+        std::cerr << "--coinc requires the default batch path\n";
+        return 1;
+    }
+
+    if (stream) {
+        // Bounded-memory path: read, filter, partition and match in
+        // fixed-size chunks; only the matches are held until the write.
+        phases.start();
+        auto res = streamProcess(filename, layers, chips,
+                                 WindowPredicate{mints, maxts},
+                                 WindowPredicate{mintot, maxtot});
+        phases.stop("pipeline");
+
+        if (!quiet) {
+            printReadSummary(res.nRead, res.nValid);
+            for (int layer = 0; layer < layers; ++layer) {
+                for (int chip = 0; chip < chips; ++chip) {
+                    std::size_t b = layer * chips + chip;
+                    printChipSummary(layer, chip, res.bucketHits[b],
+                                     res.bucketMatches[b]);
+                }
             }
+        }
 
-            auto matches = rowcolmatch(
-                datac,
-                [&](int x, int y) { return (x - y) >= mints && (x - y) <= maxts; },
-                [&](int x, int y) { return (x - y) >= mintot && (x - y) <= maxtot; }
+        if (dedup) {
+            std::size_t removed = dedupMatches(res.allMatches, dedupWindow,
+                                               threads);
+            if (!quiet) {
+                printDedupSummary(removed, res.allMatches.size());
+            }
+        }
+        writeMatches(res.allMatches);
+        if (histos) {
+            MatchHistos h(layers, chips);
+            h.fill(res.allMatches);
+            h.writeJson(matchedOutputBase(filename) + "_histos.json");
+        }
+        phases.stop("write");
+        if (stats) {
+            phases.print();
+            if (!statsJson.empty()) phases.writeJson(statsJson);
+        }
+        return 0;
+    }
+
+    if (packed) {
+        // Memory-limited batch path: filter while reading and store the
+        // survivors as 16-byte packed records, so the 48-byte AoS never
+        // materializes in full. tot_us is recovered from the per-run
+        // sampling clock scale observed on the first valid hit.
+        std::vector<PackedHalfHit> dataf;
+        std::size_t nRead = 0;
+        double totUsScale = 0.0;
+
+        ValidHalfHit valid;
+        auto consume = [&](const HalfHit& h) {
+            ++nRead;
+            if (valid(h)) {
+                if (totUsScale == 0.0 && h.tot_total > 0) {
+                    totUsScale = h.tot_us / h.tot_total;
+                }
+                dataf.push_back(packHalfHit(h));
+            }
+        };
+
+        phases.start();
+        if (ApxReader::isApxFile(filename)) {
+            for (const auto& h : ApxReader::readHalfHits(filename)) {
+                consume(h);
+            }
+        } else {
+            auto reader = openHalfHitChunkSource(filename);
+            std::vector<HalfHit> chunk;
+            while (reader->next(chunk)) {
+                for (const auto& h : chunk) {
+                    consume(h);
+                }
+            }
+        }
+        phases.stop("read+filter");
+
+        if (!quiet) {
+            printReadSummary(nRead, dataf.size());
+        }
+
+        auto parts = partitionByChip(dataf, layers, chips);
+        dataf.clear();
+        dataf.shrink_to_fit();
+        phases.stop("partition");
+
+        std::size_t nBuckets = static_cast<std::size_t>(layers) * chips;
+        std::vector<std::vector<MatchedHit>> bucketMatches(nBuckets);
+        forEachBucket(nBuckets, threads, [&](std::size_t b) {
+            int layer = static_cast<int>(b) / chips;
+            int chip = static_cast<int>(b) % chips;
+            bucketMatches[b] = rowcolmatchPacked(
+                parts.data(layer, chip),
+                parts.size(layer, chip),
+                WindowPredicate{mints, maxts},
+                WindowPredicate{mintot, maxtot},
+                totUsScale
             );
+        });
+        phases.stop("match");
+
+        std::vector<MatchedHit> allMatches;
+        for (int layer = 0; layer < layers; ++layer) {
+            for (int chip = 0; chip < chips; ++chip) {
+                const auto& matches = bucketMatches[layer * chips + chip];
+                if (!quiet) {
+                    printChipSummary(layer, chip, parts.size(layer, chip),
+                                     matches.size());
+                }
+                allMatches.insert(allMatches.end(),
+                                  matches.begin(),
+                                  matches.end());
+            }
+        }
+
+        if (dedup) {
+            std::size_t removed = dedupMatches(allMatches, dedupWindow,
+                                               threads);
+            if (!quiet) {
+                printDedupSummary(removed, allMatches.size());
+            }
+        }
+        writeMatches(allMatches);
+        if (histos) {
+            MatchHistos h(layers, chips);
+            h.fill(allMatches);
+            h.writeJson(matchedOutputBase(filename) + "_histos.json");
+        }
+        phases.stop("write");
+        if (stats) {
+            phases.print();
+            if (!statsJson.empty()) phases.writeJson(statsJson);
+        }
+        return 0;
+    }
+
+    // Native .apx readout files are decoded directly; CSV goes through
+    // the zero-copy mapped parser, with the line-based reader as a
+    // fallback for pipes and other non-seekable inputs.
+    phases.start();
+    ParseErrorStats parseErrors;
+    ChipPartitions parts;
+    std::size_t nRead = 0, nValid = 0;
+    HitCacheMeta cacheMeta;
+    if (cache && loadHitCache(filename, layers, chips, parts, cacheMeta)) {
+        // Sidecar hit: the partitioned hits are ready to match, so the
+        // whole parse/filter/partition pipeline is skipped.
+        nRead = cacheMeta.nRead;
+        nValid = cacheMeta.nValid;
+        phases.stop("cache-load");
+    } else {
+        std::vector<HalfHit> data;
+        if (tolerant) {
+            if (ApxReader::isApxFile(filename) ||
+                !CSVReader::isRegularFile(filename) ||
+                CSVReader::isCompressed(filename)) {
+                std::cerr << "--tolerant requires a plain uncompressed CSV "
+                             "file on the default path\n";
+                return 1;
+            }
+            data = CSVReader::readHalfHitsTolerant(
+                filename, threads,
+                matchedOutputBase(filename) + "_quarantine.csv", parseErrors);
+        } else {
+            data = ApxReader::isApxFile(filename)
+                ? ApxReader::readHalfHits(filename)
+                : !CSVReader::isRegularFile(filename)
+                    ? CSVReader::readHalfHitsPrefetch(filename, threads)
+                    : CSVReader::isCompressed(filename)
+                        ? CSVReader::readHalfHitsCompressed(filename)
+                        : CSVReader::readHalfHitsParallel(filename, threads);
+        }
+        phases.stop("read");
+
+        // Filter corrupted data
+        auto dataf = filterHits(data);
+        phases.stop("filter");
+
+        nRead = data.size();
+        nValid = dataf.size();
+        data.clear();
+        data.shrink_to_fit();
+
+        // Bucket hits by (layer, chip) in one pass instead of rescanning
+        // dataf once per combination.
+        parts = partitionByChip(dataf, layers, chips);
+        phases.stop("partition");
+
+        if (cache) {
+            saveHitCache(filename, layers, chips, parts,
+                         HitCacheMeta{nRead, nValid});
+            phases.stop("cache-save");
+        }
+    }
+
+    if (!quiet) {
+        printReadSummary(nRead, nValid);
+        if (tolerant) {
+            std::cout << parseErrors.total() << " malformed rows quarantined ("
+                      << parseErrors.truncated << " truncated, "
+                      << parseErrors.badNumber << " bad number, "
+                      << parseErrors.badBool << " bad boolean)\n";
+        }
+    }
 
+    // Cut-scan mode evaluates every window in one pass over the
+    // candidate pairs and writes a per-window count table (plus the
+    // full per-window match files with --scan-write) instead of a
+    // single matched output.
+    if (scan) {
+        std::size_t nBuckets = static_cast<std::size_t>(layers) * chips;
+        std::size_t nWindows = scanWindows.size();
+        std::vector<std::vector<std::size_t>> bucketCounts(
+            nBuckets, std::vector<std::size_t>(nWindows, 0));
+        std::vector<std::vector<std::vector<MatchedHit>>> bucketOutputs;
+        if (scanWrite) {
+            bucketOutputs.resize(
+                nBuckets, std::vector<std::vector<MatchedHit>>(nWindows));
+        }
+        forEachBucket(nBuckets, threads, [&](std::size_t b) {
+            int layer = static_cast<int>(b) / chips;
+            int chip = static_cast<int>(b) % chips;
+            rowcolmatchScan(parts.data(layer, chip),
+                            parts.size(layer, chip),
+                            scanWindows, bucketCounts[b],
+                            scanWrite ? &bucketOutputs[b] : nullptr);
+        });
+        phases.stop("scan");
+
+        std::string base = matchedOutputBase(filename);
+        std::ofstream summary(base + "_scan.csv");
+        if (!summary.is_open()) {
+            std::cerr << "Cannot open output file: " << base
+                      << "_scan.csv\n";
+            return 1;
+        }
+        summary << "window,mints,maxts,mintot,maxtot,matches\n";
+        for (std::size_t w = 0; w < nWindows; ++w) {
+            std::size_t total = 0;
+            for (std::size_t b = 0; b < nBuckets; ++b) {
+                total += bucketCounts[b][w];
+            }
+            const ScanWindow& win = scanWindows[w];
+            summary << w << "," << win.fts.min << "," << win.fts.max << ","
+                    << win.ftot.min << "," << win.ftot.max << ","
+                    << total << "\n";
             if (!quiet) {
-                double pct = datac.empty() ? 0.0 :
-                    100.0 * matches.size() * 2.0 / datac.size();
+                std::cout << "Window " << w
+                          << " (ts [" << win.fts.min << ", " << win.fts.max
+                          << "], tot [" << win.ftot.min << ", "
+                          << win.ftot.max << "]): " << total
+                          << " hits matched\n";
+            }
+        }
 
-                std::cout << "Layer " << layer
-                          << ", Chip " << chip
-                          << ": " << datac.size()
-                          << " halfhits found, "
-                          << matches.size()
-                          << " hits matched ("
-                          << std::fixed << std::setprecision(2) << pct << "%)\n";
+        if (scanWrite) {
+            for (std::size_t w = 0; w < nWindows; ++w) {
+                std::vector<MatchedHit> allMatches;
+                for (int layer = 0; layer < layers; ++layer) {
+                    for (int chip = 0; chip < chips; ++chip) {
+                        const auto& matches =
+                            bucketOutputs[layer * chips + chip][w];
+                        allMatches.insert(allMatches.end(),
+                                          matches.begin(), matches.end());
+                    }
+                }
+                CSVWriter::writeMatchedHits(
+                    base + "_matched_w" + std::to_string(w) + ".csv",
+                    allMatches);
             }
+            phases.stop("scan-write");
+        }
+
+        if (stats) {
+            phases.print();
+            if (!statsJson.empty()) phases.writeJson(statsJson);
+        }
+        return 0;
+    }
+
+    // The per-partition matches are independent: each bucket fills its
+    // own result slot and flags completion, so the handoff loop below
+    // stays layer-major/chip-minor and the output is byte-identical to
+    // the serial run.
+    std::size_t nBuckets = static_cast<std::size_t>(layers) * chips;
+    std::vector<std::vector<MatchedHit>> bucketMatches(nBuckets);
+    std::vector<char> bucketDone(nBuckets, 0);
+    std::mutex doneMutex;
+    std::condition_variable doneCv;
 
-            allMatches.insert(allMatches.end(),
-                              matches.begin(),
+    std::thread matcher([&]() {
+        forEachBucket(nBuckets, threads, [&](std::size_t b) {
+            int layer = static_cast<int>(b) / chips;
+            int chip = static_cast<int>(b) % chips;
+            auto match = engine == "window" ? rowcolmatchWindowed
+                                            : static_cast<
+                  std::vector<MatchedHit> (*)(const HalfHit*, size_t,
+                                              WindowPredicate,
+                                              WindowPredicate)>(rowcolmatch);
+            bucketMatches[b] = match(
+                parts.data(layer, chip),
+                parts.size(layer, chip),
+                WindowPredicate{mints, maxts},
+                WindowPredicate{mintot, maxtot}
+            );
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                bucketDone[b] = 1;
+            }
+            doneCv.notify_all();
+        });
+    });
+
+    // Writer thread with double-buffered batches: one batch is on disk
+    // while the next bucket is still matching, hiding output I/O behind
+    // compute. The binary format needs the full row count up front, so
+    // it accumulates and writes on close instead. Deduplication needs
+    // the whole match set before anything can be written, so it skips
+    // the streaming writer and writes after the collapse below.
+    std::string base = matchedOutputBase(filename);
+    BoundedQueue<std::vector<MatchedHit>> writeQueue(2);
+    std::thread writer;
+    if (!dedup) {
+        writer = std::thread([&]() {
+            std::vector<MatchedHit> batch;
+            if (format == "binary") {
+                std::vector<MatchedHit> allMatches;
+                while (writeQueue.pop(batch)) {
+                    allMatches.insert(allMatches.end(),
+                                      batch.begin(), batch.end());
+                }
+                BinaryColumnWriter::writeMatchedHits(base + "_matched.bin",
+                                                     allMatches);
+            } else {
+                CSVBatchWriter out(base + "_matched.csv");
+                while (writeQueue.pop(batch)) {
+                    out.write(batch);
+                }
+                out.close();
+            }
+        });
+    }
+
+    // Hand each bucket over as soon as it completes, in output order.
+    MatchHistos matchHistos(layers, chips);
+    for (std::size_t b = 0; b < nBuckets; ++b) {
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCv.wait(lock, [&]() { return bucketDone[b] != 0; });
+        }
+        int layer = static_cast<int>(b) / chips;
+        int chip = static_cast<int>(b) % chips;
+        if (!quiet) {
+            printChipSummary(layer, chip, parts.size(layer, chip),
+                             bucketMatches[b].size());
+        }
+        if (histos && !dedup) {
+            matchHistos.fill(bucketMatches[b]);
+        }
+        // The coincidence and dedup stages still need the per-bucket
+        // streams, so only hand the writer a batch when it is running.
+        if (!dedup) {
+            writeQueue.push(coinc ? bucketMatches[b]
+                                  : std::move(bucketMatches[b]));
+        }
+    }
+    matcher.join();
+    writeQueue.close();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    phases.stop(dedup ? "match" : "match+write");
+
+    if (coinc) {
+        writeCoincidences(base + "_coinc.csv", bucketMatches,
+                          CoincidenceOptions{coincWindow, coincLayers});
+        phases.stop("coinc");
+    }
+
+    if (dedup) {
+        std::vector<MatchedHit> allMatches;
+        std::size_t total = 0;
+        for (const auto& matches : bucketMatches) {
+            total += matches.size();
+        }
+        allMatches.reserve(total);
+        for (auto& matches : bucketMatches) {
+            allMatches.insert(allMatches.end(), matches.begin(),
                               matches.end());
         }
+        std::size_t removed = dedupMatches(allMatches, dedupWindow, threads);
+        if (!quiet) {
+            printDedupSummary(removed, allMatches.size());
+        }
+        writeMatches(allMatches);
+        if (histos) {
+            matchHistos.fill(allMatches);
+        }
+        phases.stop("dedup+write");
+    }
+
+    if (histos) {
+        matchHistos.writeJson(base + "_histos.json");
+        phases.stop("histos");
     }
 
-    CSVWriter::writeMatchedHits(
-        filename.substr(0, filename.size() - 4) + "_matched.csv",
-        allMatches
-    );
+    if (stats) {
+        phases.print();
+        if (!statsJson.empty()) phases.writeJson(statsJson);
+    }
 
     return 0;
 }
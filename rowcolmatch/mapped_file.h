@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Owns an mmap'ed read-only view of a file for the zero-copy readers.
+struct MappedFile {
+    const char* data = nullptr;
+    std::size_t size = 0;
+
+    explicit MappedFile(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            throw std::runtime_error("Cannot map file: " + filename);
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Cannot map file: " + filename);
+            }
+            madvise(map, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(map);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
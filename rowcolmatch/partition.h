@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "data_structs.h"
+
+// Contiguous per-(layer, chip) grouping of hits. Built in a single
+// counting-sort pass over the filtered data, so the matcher gets one
+// dense span per chip instead of rescanning the whole vector once per
+// (layer, chip) combination. Templated over the hit record so both the
+// full HalfHit and the packed representation can be partitioned.
+template <typename Hit>
+struct ChipPartitionsT {
+    int layers = 0;
+    int chips = 0;
+    // Hits grouped by (layer, chip), file order preserved within each
+    // group. Hits outside [0, layers) x [0, chips) are dropped, exactly
+    // as the old per-chip rescan ignored them.
+    std::vector<Hit> hits;
+    // layers * chips + 1 span boundaries into hits.
+    std::vector<std::size_t> offsets;
+
+    const Hit* data(int layer, int chip) const {
+        return hits.data() + offsets[layer * chips + chip];
+    }
+    std::size_t size(int layer, int chip) const {
+        std::size_t idx = layer * chips + chip;
+        return offsets[idx + 1] - offsets[idx];
+    }
+};
+
+using ChipPartitions = ChipPartitionsT<HalfHit>;
+
+template <typename Hit>
+ChipPartitionsT<Hit> partitionByChip(const Hit* hitData, std::size_t nHits,
+                                     int layers, int chips) {
+    ChipPartitionsT<Hit> parts;
+    parts.layers = layers;
+    parts.chips = chips;
+
+    std::size_t nBuckets = static_cast<std::size_t>(layers) * chips;
+    std::vector<std::size_t> counts(nBuckets, 0);
+
+    struct Span {
+        const Hit* data;
+        std::size_t size;
+        const Hit* begin() const { return data; }
+        const Hit* end() const { return data + size; }
+    } hits{hitData, nHits};
+
+    // Counting pass: layer and chip are tiny enumerations, so a flat
+    // bucket array indexed by layer * chips + chip covers them all.
+    for (const auto& h : hits) {
+        if (static_cast<int>(h.layer) >= 0 && static_cast<int>(h.layer) < layers &&
+            static_cast<int>(h.chipID) >= 0 && static_cast<int>(h.chipID) < chips) {
+            ++counts[h.layer * chips + h.chipID];
+        }
+    }
+
+    parts.offsets.resize(nBuckets + 1, 0);
+    for (std::size_t b = 0; b < nBuckets; ++b) {
+        parts.offsets[b + 1] = parts.offsets[b] + counts[b];
+    }
+
+    // Scatter pass: stable, so file order survives within each span.
+    parts.hits.resize(parts.offsets[nBuckets]);
+    std::vector<std::size_t> cursor(parts.offsets.begin(),
+                                    parts.offsets.end() - 1);
+    for (const auto& h : hits) {
+        if (static_cast<int>(h.layer) >= 0 && static_cast<int>(h.layer) < layers &&
+            static_cast<int>(h.chipID) >= 0 && static_cast<int>(h.chipID) < chips) {
+            parts.hits[cursor[h.layer * chips + h.chipID]++] = h;
+        }
+    }
+
+    return parts;
+}
+
+template <typename Hit>
+ChipPartitionsT<Hit> partitionByChip(const std::vector<Hit>& hits,
+                                     int layers, int chips) {
+    return partitionByChip(hits.data(), hits.size(), layers, chips);
+}
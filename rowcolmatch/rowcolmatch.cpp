@@ -1,58 +1,212 @@
+#include <algorithm>
+#include <array>
 #include <vector>
 #include <functional>
-#include <iostream>
 #include "data_structs.h"
+#include "rowcolmatch.h"
+
+std::vector<MatchedHit> rowcolmatch(
+    const HalfHit* chip0,
+    size_t n,
+    WindowPredicate fts,
+    WindowPredicate ftot)
+{
+    return rowcolmatchSoAT(chip0, n, fts, ftot);
+}
+
+std::vector<MatchedHit> rowcolmatch(
+    const std::vector<HalfHit>& chip0,
+    WindowPredicate fts,
+    WindowPredicate ftot)
+{
+    return rowcolmatchT(chip0, fts, ftot);
+}
 
 std::vector<MatchedHit> rowcolmatch(
     const std::vector<HalfHit>& chip0,
     std::function<bool(int,int)> fts,
     std::function<bool(int,int)> ftot)
+{
+    return rowcolmatchT(chip0, std::move(fts), std::move(ftot));
+}
+
+namespace {
+
+// Fallback for bursts carrying timestamps outside the 8-bit domain
+// (malformed input): plain row-by-column scan, same order as the
+// legacy engine.
+void matchBurstScan(const HalfHit* chip0,
+                    size_t rowsBegin, size_t burstBegin, size_t burstEnd,
+                    WindowPredicate fts, WindowPredicate ftot,
+                    std::vector<MatchedHit>& output) {
+    for (size_t r = rowsBegin; r < burstBegin; ++r) {
+        for (size_t c = burstBegin; c < burstEnd; ++c) {
+            if (fts(chip0[r].timestamp, chip0[c].timestamp) &&
+                ftot(chip0[r].tot_total, chip0[c].tot_total)) {
+                output.push_back(makeMatchedHit(chip0[r], chip0[c]));
+            }
+        }
+    }
+}
+
+} // namespace
+
+std::vector<MatchedHit> rowcolmatchWindowed(
+    const HalfHit* chip0,
+    size_t n,
+    WindowPredicate fts,
+    WindowPredicate ftot)
 {
     std::vector<MatchedHit> output;
+    output.reserve(match_reserve::estimate(n));
+
+    // Per-timestamp column index for the current burst. Only the keys
+    // actually touched are cleared between bursts, so indexing cost
+    // stays proportional to the burst size; the whole index is recycled
+    // per thread across buckets and files.
+    static thread_local std::array<std::vector<unsigned>, 256> buckets;
+    static thread_local std::vector<int> touched;
+    static thread_local std::vector<unsigned> candidates;
+
+    size_t pos = 0;
+    while (pos < n) {
+        // The input interleaves runs of rows with column bursts; every
+        // row of a run has exactly the following burst as candidates.
+        size_t rowsBegin = pos;
+        while (pos < n && chip0[pos].isCol == 0) ++pos;
+        size_t burstBegin = pos;
+        while (pos < n && chip0[pos].isCol == 1) ++pos;
+        if (burstBegin == pos) break;  // trailing rows with no burst
+
+        bool inDomain = true;
+        for (size_t i = rowsBegin; i < pos && inDomain; ++i) {
+            inDomain = chip0[i].timestamp >= 0 && chip0[i].timestamp < 256;
+        }
+        if (!inDomain) {
+            matchBurstScan(chip0, rowsBegin, burstBegin, pos,
+                           fts, ftot, output);
+            continue;
+        }
+
+        for (size_t c = burstBegin; c < pos; ++c) {
+            int ts = chip0[c].timestamp;
+            if (buckets[ts].empty()) touched.push_back(ts);
+            buckets[ts].push_back(static_cast<unsigned>(c));
+        }
+
+        for (size_t r = rowsBegin; r < burstBegin; ++r) {
+            const auto& rowHit = chip0[r];
+
+            // Columns matching the fts window live in the buckets keyed
+            // rowts - max .. rowts - min; clamping to the timestamp
+            // domain bounds the lookup at 256 keys for any window.
+            int lo = std::max(fts.min, rowHit.timestamp - 255);
+            int hi = std::min(fts.max, rowHit.timestamp);
+            candidates.clear();
+            for (int d = lo; d <= hi; ++d) {
+                const auto& list = buckets[rowHit.timestamp - d];
+                candidates.insert(candidates.end(),
+                                  list.begin(), list.end());
+            }
+            // Buckets for different offsets interleave in file order;
+            // restore it so the emission order matches the scan engine.
+            std::sort(candidates.begin(), candidates.end());
 
-    for (size_t linenb = 0; linenb < chip0.size(); ++linenb) {
+            for (unsigned c : candidates) {
+                const auto& colHit = chip0[c];
+                if (ftot(rowHit.tot_total, colHit.tot_total)) {
+                    output.push_back(makeMatchedHit(rowHit, colHit));
+                }
+            }
+        }
+
+        for (int ts : touched) buckets[ts].clear();
+        touched.clear();
+    }
+
+    match_reserve::record(n, output.size());
+    return output;
+}
+
+void rowcolmatchScan(
+    const HalfHit* chip0,
+    size_t n,
+    const std::vector<ScanWindow>& windows,
+    std::vector<std::size_t>& counts,
+    std::vector<std::vector<MatchedHit>>* outputs)
+{
+    std::size_t nWindows = windows.size();
+    for (size_t linenb = 0; linenb < n; ++linenb) {
         const auto& rowHit = chip0[linenb];
-        //std::cout << rowHit.toStr() << std::endl;
-
-        if (rowHit.isCol == 0) {
-            bool foundcol = false;
-            //size_t i = linenb + 1;
-            //std::cout << "Matching " << linenb << "\nrow: " << rowHit.toStr() << std::endl;
-            //while (i < chip0.size() && (!foundcol || chip0[i].isCol == 1)) {
-            for (size_t i = linenb + 1;
-                 i < chip0.size() && (!foundcol || chip0[i].isCol == 1);
-                 ++i) {
-
-                const auto& colHit = chip0[i];
-                //std::cout << i << " col: " << colHit.toStr() << " foundcol=" << foundcol << std::endl;
-                if (colHit.isCol == 1) {
-                    if (!foundcol) foundcol = true;
-
-                    if (fts(rowHit.timestamp, colHit.timestamp) &&
-                        ftot(rowHit.tot_total, colHit.tot_total)) {
-                        //std::cout << "match!" << std::endl;
-                        output.push_back({
-                            rowHit.layer,
-                            rowHit.chipID,
-                            rowHit.location,
-                            colHit.location,
-                            rowHit.timestamp,
-                            colHit.timestamp,
-                            rowHit.tot_total,
-                            colHit.tot_total,
-                            rowHit.tot_us,
-                            colHit.tot_us,
-                            rowHit.fpga_ts,
-                            colHit.fpga_ts
-                        });
+        if (rowHit.isCol != 0) continue;
+
+        bool foundcol = false;
+        for (size_t i = linenb + 1;
+             i < n && (!foundcol || chip0[i].isCol == 1);
+             ++i) {
+
+            const auto& colHit = chip0[i];
+            if (colHit.isCol != 1) continue;
+            foundcol = true;
+
+            int dts = rowHit.timestamp - colHit.timestamp;
+            int dtot = rowHit.tot_total - colHit.tot_total;
+            for (std::size_t w = 0; w < nWindows; ++w) {
+                const ScanWindow& win = windows[w];
+                if (dts >= win.fts.min && dts <= win.fts.max &&
+                    dtot >= win.ftot.min && dtot <= win.ftot.max) {
+                    ++counts[w];
+                    if (outputs) {
+                        (*outputs)[w].push_back(
+                            makeMatchedHit(rowHit, colHit));
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<MatchedHit> rowcolmatchPacked(
+    const PackedHalfHit* chip0,
+    size_t n,
+    WindowPredicate fts,
+    WindowPredicate ftot,
+    double totUsScale)
+{
+    static thread_local HitSoA soa;
+    soa.build(chip0, n);
+
+    std::vector<MatchedHit> output;
+    output.reserve(match_reserve::estimate(n));
+    [[maybe_unused]] LoopCounters counters;
+
+    for (size_t linenb = 0; linenb < n; ++linenb) {
+        if (soa.isCol[linenb]) continue;
+
+        bool foundcol = false;
+        for (size_t i = linenb + 1;
+             i < n && (!foundcol || soa.isCol[i]);
+             ++i) {
+
+            if (!soa.isCol[i]) continue;
+            foundcol = true;
+
+            if constexpr (kStatsEnabled) ++counters.comparisons;
+            if (fts(soa.timestamp[linenb], soa.timestamp[i]) &&
+                ftot(soa.tot_total[linenb], soa.tot_total[i])) {
+                if constexpr (kStatsEnabled) {
+                    ++counters.predicateHits;
+                    if (output.size() == output.capacity()) {
+                        ++counters.reallocations;
                     }
                 }
-                //++i;
+                output.push_back(makeMatchedHit(chip0[soa.index[linenb]],
+                                                chip0[soa.index[i]],
+                                                totUsScale));
             }
         }
-        //if (linenb > 100) return output;
     }
 
+    match_reserve::record(n, output.size());
     return output;
 }
-
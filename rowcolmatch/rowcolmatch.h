@@ -1,7 +1,229 @@
 #pragma once
+#include <atomic>
+#include <cstddef>
 #include <functional>
+#include <vector>
 #include "data_structs.h"
+#include "stats.h"
 
+// Adaptive output sizing for the match engines. The match rate is
+// stable within a run (it is set by the detector occupancy and the
+// cuts, not by which bucket is being matched), so the engines size each
+// output vector from the rate observed on the buckets completed so far,
+// with headroom; only the first bucket of a process falls back to a
+// fixed guess. This replaces the push_back doubling churn — dozens of
+// reallocate-and-copy cycles per large run — with at most one
+// allocation per bucket after warm-up.
+namespace match_reserve {
+
+inline std::atomic<unsigned long long> scannedHits{0};
+inline std::atomic<unsigned long long> matchedPairs{0};
+
+inline std::size_t estimate(std::size_t n) {
+    unsigned long long hits = scannedHits.load(std::memory_order_relaxed);
+    unsigned long long pairs = matchedPairs.load(std::memory_order_relaxed);
+    if (hits < 1024) {
+        // Cold start: one match per four halfhits is comfortably above
+        // the rates seen in practice.
+        return n / 4;
+    }
+    double rate = static_cast<double>(pairs) / static_cast<double>(hits);
+    return static_cast<std::size_t>(n * rate * 1.25) + 16;
+}
+
+inline void record(std::size_t n, std::size_t nMatches) {
+    scannedHits.fetch_add(n, std::memory_order_relaxed);
+    matchedPairs.fetch_add(nMatches, std::memory_order_relaxed);
+}
+
+} // namespace match_reserve
+
+// Closed-interval window test on the difference of two fields, i.e.
+// (x - y) in [min, max]. This is the predicate shape main.cpp always
+// builds for the timestamp and ToT cuts; keeping it a concrete type
+// lets the matcher inline the comparison instead of going through
+// std::function.
+struct WindowPredicate {
+    int min;
+    int max;
+    bool operator()(int x, int y) const {
+        int d = x - y;
+        return d >= min && d <= max;
+    }
+};
+
+// Core matching loop, templated over the predicate types so the
+// timestamp/ToT tests inline into the inner loop. For each row hit the
+// candidates are the hits of the next contiguous column burst. Operates
+// on a raw span so partitioned (contiguous per-chip) data can be matched
+// without copying.
+template <typename Fts, typename Ftot>
+std::vector<MatchedHit> rowcolmatchT(
+    const HalfHit* chip0,
+    size_t n,
+    Fts fts,
+    Ftot ftot)
+{
+    std::vector<MatchedHit> output;
+    output.reserve(match_reserve::estimate(n));
+    [[maybe_unused]] LoopCounters counters;
+
+    for (size_t linenb = 0; linenb < n; ++linenb) {
+        const auto& rowHit = chip0[linenb];
+
+        if (rowHit.isCol == 0) {
+            bool foundcol = false;
+            for (size_t i = linenb + 1;
+                 i < n && (!foundcol || chip0[i].isCol == 1);
+                 ++i) {
+
+                const auto& colHit = chip0[i];
+                if (colHit.isCol == 1) {
+                    if (!foundcol) foundcol = true;
+
+                    if constexpr (kStatsEnabled) ++counters.comparisons;
+                    if (fts(rowHit.timestamp, colHit.timestamp) &&
+                        ftot(rowHit.tot_total, colHit.tot_total)) {
+                        if constexpr (kStatsEnabled) {
+                            ++counters.predicateHits;
+                            if (output.size() == output.capacity()) {
+                                ++counters.reallocations;
+                            }
+                        }
+                        output.push_back(makeMatchedHit(rowHit, colHit));
+                    }
+                }
+            }
+        }
+    }
+
+    match_reserve::record(n, output.size());
+    return output;
+}
+
+// SoA variant of the match loop: the candidate scan streams through
+// dense isCol/timestamp/tot_total arrays and only dereferences the AoS
+// records (via the index array) when a match fires. Same matches, same
+// order as rowcolmatchT.
+template <typename Fts, typename Ftot>
+std::vector<MatchedHit> rowcolmatchSoAT(
+    const HalfHit* chip0,
+    size_t n,
+    Fts fts,
+    Ftot ftot)
+{
+    // The SoA scratch arrays are recycled per thread across buckets
+    // (and across files in batch mode): resize() reuses the high-water
+    // capacity, so the build stops allocating once the largest bucket
+    // has been seen.
+    static thread_local HitSoA soa;
+    soa.build(chip0, n);
+
+    std::vector<MatchedHit> output;
+    output.reserve(match_reserve::estimate(n));
+    [[maybe_unused]] LoopCounters counters;
+
+    for (size_t linenb = 0; linenb < n; ++linenb) {
+        if (soa.isCol[linenb]) continue;
+
+        bool foundcol = false;
+        for (size_t i = linenb + 1;
+             i < n && (!foundcol || soa.isCol[i]);
+             ++i) {
+
+            if (!soa.isCol[i]) continue;
+            foundcol = true;
+
+            if constexpr (kStatsEnabled) ++counters.comparisons;
+            if (fts(soa.timestamp[linenb], soa.timestamp[i]) &&
+                ftot(soa.tot_total[linenb], soa.tot_total[i])) {
+                if constexpr (kStatsEnabled) {
+                    ++counters.predicateHits;
+                    if (output.size() == output.capacity()) {
+                        ++counters.reallocations;
+                    }
+                }
+                output.push_back(makeMatchedHit(chip0[soa.index[linenb]],
+                                                chip0[soa.index[i]]));
+            }
+        }
+    }
+
+    match_reserve::record(n, output.size());
+    return output;
+}
+
+template <typename Fts, typename Ftot>
+std::vector<MatchedHit> rowcolmatchT(
+    const std::vector<HalfHit>& chip0,
+    Fts fts,
+    Ftot ftot)
+{
+    return rowcolmatchT(chip0.data(), chip0.size(), fts, ftot);
+}
+
+// Fast path for the window cuts main.cpp constructs: fully inlined,
+// branch-predictable integer arithmetic in the inner loop.
+std::vector<MatchedHit> rowcolmatch(
+    const HalfHit* chip0,
+    size_t n,
+    WindowPredicate fts,
+    WindowPredicate ftot
+);
+std::vector<MatchedHit> rowcolmatch(
+    const std::vector<HalfHit>& chip0,
+    WindowPredicate fts,
+    WindowPredicate ftot
+);
+
+// Timestamp-window match engine, selected by --engine window. The scan
+// engines re-test every column of a burst against every pending row,
+// which degrades toward quadratic when beam-spill bursts run long. This
+// engine instead indexes each burst's columns by their 8-bit timestamp
+// and looks up, per row, only the buckets inside [min, max] of the fts
+// window, giving O(n * window + matches) regardless of burst length.
+// Produces the same matches, in the same order, as rowcolmatch().
+std::vector<MatchedHit> rowcolmatchWindowed(
+    const HalfHit* chip0,
+    size_t n,
+    WindowPredicate fts,
+    WindowPredicate ftot
+);
+
+// One (mints, maxts, mintot, maxtot) tuple of a cut scan.
+struct ScanWindow {
+    WindowPredicate fts;
+    WindowPredicate ftot;
+};
+
+// Multi-window cut-scan engine (--scan): walks the candidate pairs
+// exactly once, computes the timestamp and ToT differences once per
+// pair, and tests every window against them in a dense inner loop —
+// one read+match pass for a whole parameter grid instead of one full
+// run per window. counts[w] is incremented per match of window w; when
+// outputs is non-null, (*outputs)[w] also collects the matches, in the
+// same order rowcolmatch() would emit them for that window alone.
+void rowcolmatchScan(
+    const HalfHit* chip0,
+    size_t n,
+    const std::vector<ScanWindow>& windows,
+    std::vector<std::size_t>& counts,
+    std::vector<std::vector<MatchedHit>>* outputs
+);
+
+// Match loop over the 16-byte packed representation; tot_us is
+// recomputed as tot_total * totUsScale (the per-run sampling clock
+// period) when a match is emitted.
+std::vector<MatchedHit> rowcolmatchPacked(
+    const PackedHalfHit* chip0,
+    size_t n,
+    WindowPredicate fts,
+    WindowPredicate ftot,
+    double totUsScale
+);
+
+// Compatibility entry point for arbitrary predicates; pays an indirect
+// call per comparison, so prefer the window overload on hot paths.
 std::vector<MatchedHit> rowcolmatch(
     const std::vector<HalfHit>& chip0,
     std::function<bool(int,int)> fts,
@@ -0,0 +1,166 @@
+// pybind11 bindings exposing the native matcher to the Python stack,
+// so astropix_v3_decoder.py output can feed rowcolmatch() in-process
+// instead of round-tripping through CSV (see rowcolMatching_astropix_v3.py
+// for the pandas implementation this replaces).
+//
+// Built by `make pymodule`, which needs pybind11 and numpy on the build
+// host; the rest of the tool does not depend on this translation unit.
+//
+//   import _rowcolmatch as rcm
+//   hits = rcm.pack(layer, chipID, payload, location, isCol,
+//                   timestamp, tot_total, tot_us, fpga_ts)
+//   valid = rcm.filter(hits)              # zero-copy in, new array out
+//   matches = rcm.match(valid)            # structured MatchedHit array
+//
+// Structured arrays with the HalfHit/MatchedHit dtype cross the
+// boundary by buffer protocol without copying: filter() and match()
+// read the input in place, and the returned arrays wrap the C++ result
+// vectors directly (ownership is handed to a capsule, not copied).
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "data_structs.h"
+#include "filter.h"
+#include "partition.h"
+#include "rowcolmatch.h"
+
+namespace py = pybind11;
+
+namespace {
+
+// Wraps a result vector as a numpy array without copying: the vector
+// moves into a capsule that numpy keeps alive as the array base.
+template <typename T>
+py::array vectorToArray(std::vector<T>&& data) {
+    auto holder = std::make_unique<std::vector<T>>(std::move(data));
+    auto* ptr = holder.get();
+    py::capsule base(holder.release(), [](void* p) {
+        delete static_cast<std::vector<T>*>(p);
+    });
+    return py::array_t<T>(ptr->size(), ptr->data(), base);
+}
+
+// Borrows a structured HalfHit array as a raw span; throws if the
+// array is not contiguous (a copy would defeat the point).
+std::pair<const HalfHit*, std::size_t> asSpan(
+    const py::array_t<HalfHit, py::array::c_style>& hits) {
+    return {hits.data(), static_cast<std::size_t>(hits.size())};
+}
+
+py::array pyPack(py::array_t<int> layer, py::array_t<int> chipID,
+                 py::array_t<int> payload, py::array_t<int> location,
+                 py::array_t<int> isCol, py::array_t<int> timestamp,
+                 py::array_t<int> tot_total, py::array_t<double> tot_us,
+                 py::array_t<long long> fpga_ts) {
+    std::size_t n = static_cast<std::size_t>(layer.size());
+    if (static_cast<std::size_t>(chipID.size()) != n ||
+        static_cast<std::size_t>(payload.size()) != n ||
+        static_cast<std::size_t>(location.size()) != n ||
+        static_cast<std::size_t>(isCol.size()) != n ||
+        static_cast<std::size_t>(timestamp.size()) != n ||
+        static_cast<std::size_t>(tot_total.size()) != n ||
+        static_cast<std::size_t>(tot_us.size()) != n ||
+        static_cast<std::size_t>(fpga_ts.size()) != n) {
+        throw std::invalid_argument("pack: column lengths differ");
+    }
+
+    auto la = layer.unchecked<1>();
+    auto ch = chipID.unchecked<1>();
+    auto pa = payload.unchecked<1>();
+    auto lo = location.unchecked<1>();
+    auto ic = isCol.unchecked<1>();
+    auto ts = timestamp.unchecked<1>();
+    auto tt = tot_total.unchecked<1>();
+    auto tu = tot_us.unchecked<1>();
+    auto ft = fpga_ts.unchecked<1>();
+
+    std::vector<HalfHit> hits(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        hits[i] = HalfHit{la(i), ch(i), pa(i), lo(i), ic(i),
+                          ts(i), tt(i), tu(i), ft(i)};
+    }
+    return vectorToArray(std::move(hits));
+}
+
+py::array pyFilter(const py::array_t<HalfHit, py::array::c_style>& hits) {
+    auto [data, n] = asSpan(hits);
+    return vectorToArray(filterHits(data, n, ValidHalfHit{}));
+}
+
+py::array pyMatch(const py::array_t<HalfHit, py::array::c_style>& hits,
+                  int mints, int maxts, int mintot, int maxtot,
+                  int layers, int chips, const std::string& engine) {
+    auto [data, n] = asSpan(hits);
+    WindowPredicate fts{mints, maxts};
+    WindowPredicate ftot{mintot, maxtot};
+
+    // Same pipeline as the batch path in main.cpp: bucket by (layer,
+    // chip), match each bucket, merge layer-major.
+    auto parts = partitionByChip(data, n, layers, chips);
+
+    std::vector<MatchedHit> allMatches;
+    for (int layer = 0; layer < layers; ++layer) {
+        for (int chip = 0; chip < chips; ++chip) {
+            auto matches = engine == "window"
+                ? rowcolmatchWindowed(parts.data(layer, chip),
+                                      parts.size(layer, chip), fts, ftot)
+                : rowcolmatch(parts.data(layer, chip),
+                              parts.size(layer, chip), fts, ftot);
+            allMatches.insert(allMatches.end(),
+                              matches.begin(), matches.end());
+        }
+    }
+    return vectorToArray(std::move(allMatches));
+}
+
+// Single-chip entry point for callers that have already bucketed their
+// hits: matches the span in place with no partition pass at all.
+py::array pyMatchChip(const py::array_t<HalfHit, py::array::c_style>& hits,
+                      int mints, int maxts, int mintot, int maxtot,
+                      const std::string& engine) {
+    auto [data, n] = asSpan(hits);
+    WindowPredicate fts{mints, maxts};
+    WindowPredicate ftot{mintot, maxtot};
+    return vectorToArray(engine == "window"
+        ? rowcolmatchWindowed(data, n, fts, ftot)
+        : rowcolmatch(data, n, fts, ftot));
+}
+
+} // namespace
+
+PYBIND11_MODULE(_rowcolmatch, m) {
+    m.doc() = "Native AstroPix row/column matcher (see rowcolmatch/)";
+
+    PYBIND11_NUMPY_DTYPE(HalfHit, layer, chipID, payload, location,
+                         isCol, timestamp, tot_total, tot_us, fpga_ts);
+    PYBIND11_NUMPY_DTYPE(MatchedHit, layer, chipID, row, col,
+                         row_timestamp, col_timestamp, row_tot, col_tot,
+                         row_tot_us, col_tot_us,
+                         row_fpga_ts, col_fpga_ts);
+
+    m.def("pack", &pyPack,
+          py::arg("layer"), py::arg("chipID"), py::arg("payload"),
+          py::arg("location"), py::arg("isCol"), py::arg("timestamp"),
+          py::arg("tot_total"), py::arg("tot_us"), py::arg("fpga_ts"),
+          "Gathers separate column arrays into a HalfHit structured array");
+
+    m.def("filter", &pyFilter, py::arg("hits"),
+          "Drops corrupted hits (payload != 4 or location out of range)");
+
+    m.def("match", &pyMatch, py::arg("hits"),
+          py::arg("mints") = 0, py::arg("maxts") = 1,
+          py::arg("mintot") = 6, py::arg("maxtot") = 15,
+          py::arg("layers") = 3, py::arg("chips") = 4,
+          py::arg("engine") = "scan",
+          "Partitions by (layer, chip) and matches every bucket; returns "
+          "a MatchedHit structured array in the CSV output order");
+
+    m.def("match_chip", &pyMatchChip, py::arg("hits"),
+          py::arg("mints") = 0, py::arg("maxts") = 1,
+          py::arg("mintot") = 6, py::arg("maxtot") = 15,
+          py::arg("engine") = "scan",
+          "Matches one already-bucketed chip span without partitioning");
+}
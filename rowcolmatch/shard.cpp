@@ -0,0 +1,266 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "csv_io.h"
+#include "filter.h"
+#include "mapped_file.h"
+#include "shard.h"
+#include "stream.h"
+
+namespace {
+
+// Per-bucket ownership around a shard boundary. The predecessor shard
+// keeps feeding a bucket past its range end until the open burst
+// closes, so the successor must skip exactly those hits. Which ones
+// they are follows from the type of the bucket's last hit before the
+// boundary (the predecessor's buffer is never empty once a hit has
+// arrived, and its tail is what the last hit left behind):
+//   - no hit:   the predecessor held nothing; process from the start.
+//   - row hit:  the predecessor's row group was still open; it consumed
+//               the following column burst and the row that closed it,
+//               so skip until a column has passed and a row follows.
+//   - col hit:  the predecessor's burst was open; it consumed the
+//               remaining columns and the closing row, so skip columns
+//               and start processing at the first row.
+enum class SkipState { Active, NeedCol, NeedRow };
+
+// Start of shard `index` of `count` within [begin, end): the nominal
+// byte cut snapped forward past the next newline, so no line straddles
+// two shards and every shard derives identical cuts independently.
+const char* shardCut(const char* begin, const char* end,
+                     std::size_t index, std::size_t count) {
+    if (index == 0) return begin;
+    if (index >= count) return end;
+    const char* cut = begin + (end - begin) * index / count;
+    const char* nl = static_cast<const char*>(
+        std::memchr(cut, '\n', end - cut));
+    return nl ? nl + 1 : end;
+}
+
+std::string shardPath(const std::string& filename, int index) {
+    return matchedOutputBase(filename) + "_shard" + std::to_string(index) +
+           "_matched.csv";
+}
+
+} // namespace
+
+int processShard(const std::string& filename, const ShardOptions& opt) {
+    MappedFile map(filename);
+    const char* fileEnd = map.data + map.size;
+    const char* nl = map.size
+        ? static_cast<const char*>(std::memchr(map.data, '\n', map.size))
+        : nullptr;
+    const char* dataBegin = nl ? nl + 1 : fileEnd;
+
+    std::size_t index = static_cast<std::size_t>(opt.index);
+    std::size_t count = static_cast<std::size_t>(opt.count);
+    const char* start = shardCut(dataBegin, fileEnd, index, count);
+    const char* stop = shardCut(dataBegin, fileEnd, index + 1, count);
+
+    const std::size_t nBuckets =
+        static_cast<std::size_t>(opt.layers) * opt.chips;
+    std::vector<StreamChipMatcher> matchers(
+        nBuckets, StreamChipMatcher(opt.fts, opt.ftot));
+    std::vector<std::vector<MatchedHit>> bucketMatches(nBuckets);
+    std::vector<SkipState> skip(nBuckets, SkipState::Active);
+    ValidHalfHit valid;
+
+    auto inRange = [&](const HalfHit& h) {
+        return h.layer >= 0 && h.layer < opt.layers &&
+               h.chipID >= 0 && h.chipID < opt.chips;
+    };
+
+    // Predecessor boundary state (see SkipState) is reconstructed
+    // lazily: the backward scan from the shard start only resumes when
+    // the forward pass meets a bucket it has not resolved yet, and
+    // stops at that bucket. Buckets absent from the shard's range —
+    // dead chips, a geometry configured wider than the data — are
+    // never consulted, so they never drag the scan through the whole
+    // file prefix looking for hits that do not exist.
+    std::vector<char> resolved(nBuckets, 0);
+    const char* tail = start;
+    auto resolveBoundary = [&](std::size_t bucket) {
+        while (!resolved[bucket] && tail > dataBegin) {
+            const char* q = tail - 1;  // at the '\n' ending the line
+            while (q > dataBegin && q[-1] != '\n') --q;
+            const char* lineEnd = tail - 1;
+            if (lineEnd > q && lineEnd[-1] == '\r') --lineEnd;
+            if (lineEnd > q) {
+                HalfHit h = CSVReader::parseLine(q, lineEnd);
+                if (valid(h) && inRange(h)) {
+                    std::size_t b = h.layer * opt.chips + h.chipID;
+                    if (!resolved[b]) {
+                        resolved[b] = 1;
+                        skip[b] = h.isCol ? SkipState::NeedRow
+                                          : SkipState::NeedCol;
+                    }
+                }
+            }
+            tail = q;
+        }
+        // Running out of prefix means the bucket has no pre-boundary
+        // hit: the predecessor held nothing, so the default Active
+        // state stands.
+        resolved[bucket] = 1;
+    };
+
+    auto feed = [&](const HalfHit& h) {
+        std::size_t b = h.layer * opt.chips + h.chipID;
+        if (!resolved[b]) resolveBoundary(b);
+        switch (skip[b]) {
+        case SkipState::NeedCol:
+            // Still inside the predecessor's row group or burst.
+            if (h.isCol) skip[b] = SkipState::NeedRow;
+            break;
+        case SkipState::NeedRow:
+            if (!h.isCol) {
+                // The row that closed the predecessor's burst; it was
+                // discarded there, so it opens this shard's first group.
+                skip[b] = SkipState::Active;
+                matchers[b].add(h, bucketMatches[b]);
+            }
+            break;
+        case SkipState::Active:
+            matchers[b].add(h, bucketMatches[b]);
+            break;
+        }
+    };
+
+    std::size_t nRead = 0;
+    std::size_t nValid = 0;
+    const char* p = start;
+    while (p < stop) {
+        const char* lineEnd = static_cast<const char*>(
+            std::memchr(p, '\n', stop - p));
+        const char* next = lineEnd ? lineEnd + 1 : stop;
+        if (!lineEnd) lineEnd = stop;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+        if (lineEnd > p) {
+            HalfHit h = CSVReader::parseLine(p, lineEnd);
+            ++nRead;
+            if (valid(h) && inRange(h)) {
+                ++nValid;
+                feed(h);
+            }
+        }
+        p = next;
+    }
+
+    // Read past the range end until every open bucket's burst closes.
+    // A bucket with an empty buffer owes nothing: the hits beyond the
+    // boundary belong to the successor shard. The row that closes a
+    // burst is added (it triggers the emission) and then abandoned —
+    // the successor re-reads it as its first row.
+    std::vector<char> open(nBuckets, 0);
+    std::size_t nOpen = 0;
+    for (std::size_t b = 0; b < nBuckets; ++b) {
+        if (!matchers[b].pending().empty()) {
+            open[b] = 1;
+            ++nOpen;
+        }
+    }
+    p = stop;
+    while (p < fileEnd && nOpen > 0) {
+        const char* lineEnd = static_cast<const char*>(
+            std::memchr(p, '\n', fileEnd - p));
+        const char* next = lineEnd ? lineEnd + 1 : fileEnd;
+        if (!lineEnd) lineEnd = fileEnd;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+        if (lineEnd > p) {
+            HalfHit h = CSVReader::parseLine(p, lineEnd);
+            if (valid(h) && inRange(h)) {
+                std::size_t b = h.layer * opt.chips + h.chipID;
+                if (open[b]) {
+                    bool closes = h.isCol == 0 &&
+                                  matchers[b].pending().back().isCol == 1;
+                    matchers[b].add(h, bucketMatches[b]);
+                    if (closes) {
+                        open[b] = 0;
+                        --nOpen;
+                    }
+                }
+            }
+        }
+        p = next;
+    }
+    // Buckets still open at end of file mirror the single-node
+    // end-of-input flush: their final burst never closes anywhere.
+    for (std::size_t b = 0; b < nBuckets; ++b) {
+        if (open[b]) matchers[b].flush(bucketMatches[b]);
+    }
+
+    std::size_t nMatches = 0;
+    {
+        CSVBatchWriter writer(shardPath(filename, opt.index));
+        for (std::size_t b = 0; b < nBuckets; ++b) {
+            writer.write(bucketMatches[b]);
+            nMatches += bucketMatches[b].size();
+        }
+        writer.close();
+    }
+
+    if (!opt.quiet) {
+        std::cout << "Shard " << opt.index << "/" << opt.count << ": "
+                  << nRead << " halfhits read, " << nValid << " valid, "
+                  << nMatches << " hits matched" << std::endl;
+    }
+    return 0;
+}
+
+int mergeShards(const std::string& filename, int count, bool quiet) {
+    // Shard outputs hold whole buckets in layer-major order, so the
+    // merge is pure text plumbing: group rows by (layer, chip) from
+    // their own columns, preserving shard-then-position order within
+    // each bucket, and renumber the index column.
+    std::map<std::pair<int, int>, std::vector<std::string>> buckets;
+    std::string header;
+    for (int i = 0; i < count; ++i) {
+        std::ifstream in(shardPath(filename, i));
+        if (!in.is_open()) {
+            std::cerr << "Missing shard output: " << shardPath(filename, i)
+                      << std::endl;
+            return 1;
+        }
+        std::string line;
+        std::getline(in, line);
+        if (i == 0) header = line;
+        while (std::getline(in, line)) {
+            std::size_t comma = line.find(',');
+            if (comma == std::string::npos) continue;
+            int layer = 0;
+            int chip = 0;
+            if (std::sscanf(line.c_str() + comma, ",%d,%d",
+                            &layer, &chip) != 2) {
+                continue;
+            }
+            // Keep everything after the shard-local index verbatim.
+            buckets[{layer, chip}].push_back(line.substr(comma));
+        }
+    }
+
+    std::string outPath = matchedOutputBase(filename) + "_matched.csv";
+    std::ofstream out(outPath);
+    if (!out.is_open()) {
+        std::cerr << "Cannot open output file: " << outPath << std::endl;
+        return 1;
+    }
+    out << header << '\n';
+    std::size_t index = 0;
+    for (const auto& bucket : buckets) {
+        for (const std::string& row : bucket.second) {
+            out << index++ << row << '\n';
+        }
+    }
+    out.close();
+
+    if (!quiet) {
+        std::cout << index << " matched hits merged from " << count
+                  << " shards into " << outPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include "rowcolmatch.h"
+
+// Sharded multi-node processing. `--shard i/N` matches the i-th of N
+// newline-aligned byte ranges of one input CSV and writes its matches
+// to <base>_shard<i>_matched.csv; `--merge N` concatenates the N shard
+// outputs bucket by bucket into the regular <base>_matched.csv. Every
+// node maps the same file (no pre-splitting step), and the merged
+// output is byte-identical to a single-node run.
+//
+// A match is owned by the shard whose byte range contains its row hit.
+// Bursts spanning a shard edge are handled by reading past the range
+// end until each open bucket's burst closes, while the successor shard
+// skips the leading hits its predecessor consumed; the predecessor's
+// buffer state at the boundary is reconstructed from the type of each
+// bucket's last pre-boundary hit, so no coordination between nodes is
+// needed.
+struct ShardOptions {
+    int index = 0;
+    int count = 1;
+    int layers = 3;
+    int chips = 4;
+    WindowPredicate fts{0, 1};
+    WindowPredicate ftot{6, 15};
+    bool quiet = false;
+};
+
+int processShard(const std::string& filename, const ShardOptions& opt);
+int mergeShards(const std::string& filename, int count, bool quiet);
@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Lightweight instrumentation for the pipeline, surfaced by --stats.
+//
+// Phase timers are plain steady_clock reads around the read/filter/
+// partition/match/write stages and are always available. The inner-loop
+// counters (candidate comparisons, predicate hits, output vector
+// reallocations) sit on the hot path, so they are compiled to nothing
+// unless the binary is built with `make STATS=1` (-DRCM_STATS); the
+// loops keep local counters and flush them once per call, guarded by
+// `if constexpr`, so the default build pays zero cost.
+
+#ifdef RCM_STATS
+inline constexpr bool kStatsEnabled = true;
+#else
+inline constexpr bool kStatsEnabled = false;
+#endif
+
+struct MatchCounters {
+    std::atomic<unsigned long long> comparisons{0};
+    std::atomic<unsigned long long> predicateHits{0};
+    std::atomic<unsigned long long> reallocations{0};
+};
+
+inline MatchCounters gMatchCounters;
+
+// Per-call scratch counters flushed into the global atomics on
+// destruction, so the inner loop never touches shared state.
+struct LoopCounters {
+    unsigned long long comparisons = 0;
+    unsigned long long predicateHits = 0;
+    unsigned long long reallocations = 0;
+
+    ~LoopCounters() {
+        if constexpr (kStatsEnabled) {
+            gMatchCounters.comparisons.fetch_add(
+                comparisons, std::memory_order_relaxed);
+            gMatchCounters.predicateHits.fetch_add(
+                predicateHits, std::memory_order_relaxed);
+            gMatchCounters.reallocations.fetch_add(
+                reallocations, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Wall-clock accounting for the pipeline phases.
+class PhaseStats {
+public:
+    using clock = std::chrono::steady_clock;
+
+    void start() {
+        t0_ = clock::now();
+    }
+
+    void stop(const std::string& phase) {
+        double secs = std::chrono::duration<double>(clock::now() - t0_).count();
+        phases_.emplace_back(phase, secs);
+        t0_ = clock::now();
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        os << "--- stats ---\n";
+        double total = 0;
+        for (const auto& [phase, secs] : phases_) {
+            os << "  " << std::left << std::setw(12) << phase
+               << std::fixed << std::setprecision(3) << secs << " s\n";
+            total += secs;
+        }
+        os << "  " << std::left << std::setw(12) << "total"
+           << std::fixed << std::setprecision(3) << total << " s\n";
+        if constexpr (kStatsEnabled) {
+            os << "  comparisons    "
+               << gMatchCounters.comparisons.load() << "\n"
+               << "  predicate hits "
+               << gMatchCounters.predicateHits.load() << "\n"
+               << "  reallocations  "
+               << gMatchCounters.reallocations.load() << "\n";
+        } else {
+            os << "  (inner-loop counters need a STATS=1 build)\n";
+        }
+    }
+
+    void writeJson(const std::string& path) const {
+        std::ofstream os(path);
+        os << "{\n  \"phases\": {";
+        for (std::size_t i = 0; i < phases_.size(); ++i) {
+            os << (i ? ", " : "") << "\"" << phases_[i].first << "\": "
+               << phases_[i].second;
+        }
+        os << "}";
+        if constexpr (kStatsEnabled) {
+            os << ",\n  \"comparisons\": "
+               << gMatchCounters.comparisons.load()
+               << ",\n  \"predicate_hits\": "
+               << gMatchCounters.predicateHits.load()
+               << ",\n  \"reallocations\": "
+               << gMatchCounters.reallocations.load();
+        }
+        os << "\n}\n";
+    }
+
+private:
+    clock::time_point t0_ = clock::now();
+    std::vector<std::pair<std::string, double>> phases_;
+};
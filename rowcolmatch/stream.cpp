@@ -0,0 +1,113 @@
+#include "stream.h"
+#include <memory>
+#include <thread>
+#include "bounded_queue.h"
+#include "filter.h"
+#include "csv_io.h"
+
+void StreamChipMatcher::add(const HalfHit& h, std::vector<MatchedHit>& out) {
+    // A row arriving after one or more columns closes the burst: every
+    // buffered row has now seen its full candidate set.
+    if (h.isCol == 0 && !buf_.empty() && buf_.back().isCol == 1) {
+        closeBurst(out);
+    }
+    buf_.push_back(h);
+}
+
+void StreamChipMatcher::flush(std::vector<MatchedHit>& out) {
+    closeBurst(out);
+    buf_.clear();
+}
+
+void StreamChipMatcher::closeBurst(std::vector<MatchedHit>& out) {
+    // The buffer holds the rows awaiting this burst followed by the
+    // burst's columns; trailing rows with no burst match nothing, just
+    // like the batch scan.
+    std::size_t burst = buf_.size();
+    while (burst > 0 && buf_[burst - 1].isCol == 1) {
+        --burst;
+    }
+
+    for (std::size_t r = 0; r < burst; ++r) {
+        const auto& rowHit = buf_[r];
+        if (rowHit.isCol != 0) continue;
+        for (std::size_t c = burst; c < buf_.size(); ++c) {
+            const auto& colHit = buf_[c];
+            if (fts_(rowHit.timestamp, colHit.timestamp) &&
+                ftot_(rowHit.tot_total, colHit.tot_total)) {
+                out.push_back(makeMatchedHit(rowHit, colHit));
+            }
+        }
+    }
+    buf_.clear();
+}
+
+StreamResult streamProcess(const std::string& filename,
+                           int layers, int chips,
+                           WindowPredicate fts, WindowPredicate ftot) {
+    StreamResult res;
+    std::size_t nBuckets = static_cast<std::size_t>(layers) * chips;
+    res.bucketHits.assign(nBuckets, 0);
+    res.bucketMatches.assign(nBuckets, 0);
+
+    std::vector<StreamChipMatcher> matchers(
+        nBuckets, StreamChipMatcher(fts, ftot));
+    std::vector<std::vector<MatchedHit>> bucketOut(nBuckets);
+
+    // Producer: chunked reads feeding a shallow queue, so at most a few
+    // chunks of decoded hits are in flight at any time.
+    BoundedQueue<std::vector<HalfHit>> queue(4);
+    std::thread producer([&]() {
+        try {
+            auto reader = openHalfHitChunkSource(filename);
+            std::vector<HalfHit> chunk;
+            while (reader->next(chunk)) {
+                queue.push(std::move(chunk));
+                chunk = {};
+            }
+        } catch (...) {
+            // Surface read errors as a closed queue; the consumer ends
+            // with whatever was parsed so far.
+        }
+        queue.close();
+    });
+
+    ValidHalfHit valid;
+    std::vector<HalfHit> chunk;
+    while (queue.pop(chunk)) {
+        res.nRead += chunk.size();
+        for (const auto& h : chunk) {
+            if (!valid(h)) {
+                continue;
+            }
+            ++res.nValid;
+            if (h.layer < 0 || h.layer >= layers ||
+                h.chipID < 0 || h.chipID >= chips) {
+                continue;
+            }
+            std::size_t b = h.layer * chips + h.chipID;
+            ++res.bucketHits[b];
+            matchers[b].add(h, bucketOut[b]);
+        }
+    }
+    producer.join();
+
+    for (std::size_t b = 0; b < nBuckets; ++b) {
+        matchers[b].flush(bucketOut[b]);
+        res.bucketMatches[b] = bucketOut[b].size();
+    }
+
+    // Layer-major merge keeps the output ordering identical to the
+    // batch path.
+    std::size_t total = 0;
+    for (const auto& out : bucketOut) {
+        total += out.size();
+    }
+    res.allMatches.reserve(total);
+    for (auto& out : bucketOut) {
+        res.allMatches.insert(res.allMatches.end(), out.begin(), out.end());
+        out.clear();
+        out.shrink_to_fit();
+    }
+    return res;
+}
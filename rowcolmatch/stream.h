@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "data_structs.h"
+#include "rowcolmatch.h"
+
+// Incremental per-chip matcher for the streaming pipeline. Hits are fed
+// in file order; the matcher only needs to buffer hits until the next
+// column burst closes (a row arriving after one or more columns), at
+// which point every buffered row is matched against the burst and the
+// buffer is recycled. Produces the same matches, in the same order, as
+// rowcolmatch() over the full per-chip vector.
+class StreamChipMatcher {
+public:
+    StreamChipMatcher(WindowPredicate fts, WindowPredicate ftot)
+        : fts_(fts), ftot_(ftot) {}
+
+    void add(const HalfHit& h, std::vector<MatchedHit>& out);
+    // Closes the final column burst at end of input.
+    void flush(std::vector<MatchedHit>& out);
+    // Hits still waiting for their burst to close; persisted by the
+    // incremental checkpoint and re-fed through restore() on resume.
+    const std::vector<HalfHit>& pending() const { return buf_; }
+    void restore(std::vector<HalfHit> buffered) { buf_ = std::move(buffered); }
+
+private:
+    void closeBurst(std::vector<MatchedHit>& out);
+
+    WindowPredicate fts_;
+    WindowPredicate ftot_;
+    std::vector<HalfHit> buf_;
+};
+
+struct StreamResult {
+    std::size_t nRead = 0;
+    std::size_t nValid = 0;
+    // layers * chips entries, layer-major.
+    std::vector<std::size_t> bucketHits;
+    std::vector<std::size_t> bucketMatches;
+    std::vector<MatchedHit> allMatches;
+};
+
+// Bounded-memory pipeline: reads the input in fixed-size chunks on a
+// producer thread, then filters, partitions and matches on the fly.
+// Peak memory is set by the chunk size and queue depth, not by the
+// input file size.
+StreamResult streamProcess(const std::string& filename,
+                           int layers, int chips,
+                           WindowPredicate fts, WindowPredicate ftot);